@@ -0,0 +1,95 @@
+#include <c2p/ini.hpp>
+#include <c2p/json.hpp>
+#include <chrono>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+/// Generate a JSON config with `count` tenant objects.
+static std::string makeJson(size_t count) {
+    std::string json = "{\n  \"tenants\": [\n";
+    for (size_t idx = 0; idx < count; ++idx) {
+        const std::string id = std::to_string(idx);
+        json += "    {\n"
+                "      \"id\": " + id + ",\n"
+                "      \"name\": \"tenant-" + id + "\",\n"
+                "      \"enable\": true,\n"
+                "      \"port\": 8080,\n"
+                "      \"timeout\": 1.5,\n"
+                "      \"tags\": [\"a\", \"b\", null],\n"
+                "      \"limits\": { \"cpu\": 2, \"mem\": \"4Gi\" }\n"
+                "    }";
+        json += (idx + 1 < count) ? ",\n" : "\n";
+    }
+    json += "  ]\n}\n";
+    return json;
+}
+
+/// Generate an INI config with `count` tenant sections.
+static std::string makeIni(size_t count) {
+    std::string ini = "name = service\n";
+    for (size_t idx = 0; idx < count; ++idx) {
+        const std::string id = std::to_string(idx);
+        ini += "\n[tenant-" + id + "]\n"
+               "id = " + id + "\n"
+               "enable = true\n"
+               "port = 8080\n"
+               "timeout = 1.5\n"
+               "mem = 4Gi\n";
+    }
+    return ini;
+}
+
+/// Run `func` `iterations` times and print the throughput.
+template <typename Func>
+static void run(
+    const std::string& name,
+    size_t inputSize,
+    size_t iterations,
+    Func&& func
+) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t iter = 0; iter < iterations; ++iter) {
+        func();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << name << ": " << (iterations / seconds) << " op/s, "
+              << (double(inputSize) * iterations / seconds / 1e6) << " MB/s"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000;
+    const size_t iterations = argc > 2 ? std::stoul(argv[2]) : 50;
+
+    const std::string json = makeJson(count);
+    const std::string ini = makeIni(count);
+    std::cout << "JSON size: " << json.size() << " bytes, INI size: "
+              << ini.size() << " bytes, iterations: " << iterations
+              << std::endl;
+
+    // One buffer reused by every iteration, like a long-running service.
+    std::vector<std::byte> buffer(json.size() * 8);
+
+    run("json::parse + destroy (heap)", json.size(), iterations, [&]() {
+        const auto tree = c2p::json::parse(json);
+    });
+    run("json::parse + destroy (arena)", json.size(), iterations, [&]() {
+        std::pmr::monotonic_buffer_resource arena(
+            buffer.data(), buffer.size()
+        );
+        const auto tree = c2p::json::parse(json, &arena);
+    });
+
+    run("ini::parse + destroy (heap)", ini.size(), iterations, [&]() {
+        const auto tree = c2p::ini::parse(ini);
+    });
+    run("ini::parse + destroy (arena)", ini.size(), iterations, [&]() {
+        std::pmr::monotonic_buffer_resource arena(
+            buffer.data(), buffer.size()
+        );
+        const auto tree = c2p::ini::parse(ini, &arena);
+    });
+}
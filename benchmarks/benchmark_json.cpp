@@ -0,0 +1,62 @@
+#include "text_scan.hpp"
+
+#include <c2p/json.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+/// Generate a pretty printed JSON config of about `size` bytes, with long
+/// string values and deep indentation.
+static std::string makeStringsJson(size_t size) {
+    const std::string indent(16, ' ');
+    const std::string text =
+        "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+        "eiusmod tempor incididunt ut labore et dolore magna aliqua.";
+    std::string json = "{\n    \"items\": [\n";
+    for (size_t idx = 0; json.size() < size; ++idx) {
+        if (idx > 0) json += ",\n";
+        json += indent + "{\n";
+        json += indent + "    \"name\": \"item-" + std::to_string(idx) + "\",\n";
+        json += indent + "    \"description\": \"" + text + "\",\n";
+        json += indent + "    \"path\": \"/usr/share/c2p/items/"
+              + std::to_string(idx) + "/config.json\"\n";
+        json += indent + "}";
+    }
+    json += "\n    ]\n}\n";
+    return json;
+}
+
+/// Generate a compact JSON config of about `size` bytes, mostly numbers.
+static std::string makeNumbersJson(size_t size) {
+    std::string json = "[";
+    for (size_t idx = 0; json.size() < size; ++idx) {
+        if (idx > 0) json += ",";
+        json += "[" + std::to_string(idx) + ",-" + std::to_string(idx % 97)
+              + ".25,1e3,true,null]";
+    }
+    json += "]";
+    return json;
+}
+
+static void run(const std::string& name, const std::string& json) {
+    const size_t iterations = std::max<size_t>(1, (64u << 20) / json.size());
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t iter = 0; iter < iterations; ++iter) {
+        const auto tree = c2p::json::parse(json);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << name << " (" << json.size() << " bytes): "
+              << (double(json.size()) * iterations / seconds / 1e9) << " GB/s"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    const size_t size = argc > 1 ? std::stoul(argv[1]) : (4u << 20);
+
+    std::cout << "scan implementation: " << c2p::scanImplementation()
+              << std::endl;
+
+    run("json::parse strings", makeStringsJson(size));
+    run("json::parse numbers", makeNumbersJson(size));
+}
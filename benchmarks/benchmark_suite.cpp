@@ -0,0 +1,730 @@
+/// Benchmark suite of parsers, dumpers and tree operations.
+///
+/// Usage: benchmark_suite [--max-size=SIZE] [--filter=TEXT] [--min-time=SEC]
+///
+/// - `--max-size`: largest input size, e.g. "100M". Default "16M".
+/// - `--filter`: only run cases whose name contains TEXT.
+/// - `--min-time`: minimum measured time of each case. Default 0.2.
+///
+/// Every case prints one JSON object per line:
+/// - "case", "input", "size": name of the case, its input and input bytes.
+/// - "iterations", "seconds": measured operations and their total time.
+/// - "ops_per_s", "mb_per_s": throughput, MB/s is of the input size.
+/// - "allocs_per_op", "alloc_bytes_per_op": global operator new calls.
+/// - "peak_bytes": peak live heap bytes during the case, above its start.
+///
+/// "snapshots_deep" and "snapshots_shared" compare the cost of 16 modified
+/// copies of a tree, without and with `ValueTree::share()`.
+/// "json_lazy_one" indexes a copy of the input as a `json::LazyDocument` and
+/// parses the middle element of its main array only.
+/// "json_events" and "ini_events" stream through the input with a handler
+/// which counts values, without building a tree.
+/// "json_parse_into" and "ini_parse_into" reload the input into the tree of
+/// the last iteration, see `json::parseInto`.
+/// "json_lines" parses one tenant per line with 1, 2, 4 and 8 threads.
+/// "json_parse_parallel" parses the root arrays of "strings" and "numbers"
+/// with 1, 2, 4 and 8 threads.
+/// "json_push" feeds the input to a `json::PushParser` in 64 KB chunks.
+/// "json_read_parse" reads a file of the input into a string and parses it,
+/// "json_parse_file" parses the same file with `json::parseFile`.
+/// "snapshot_load" maps a snapshot file of the tree and looks up one value.
+/// A last line reports the peak resident set size of the process.
+
+#include <c2p/c2p.hpp>
+#include <c2p/cli.hpp>
+#include <c2p/ini.hpp>
+#include <c2p/diff.hpp>
+#include <c2p/frozen_tree.hpp>
+#include <c2p/hash.hpp>
+#include <c2p/json.hpp>
+#include <c2p/merge.hpp>
+#include <c2p/snapshot.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// ============================================================
+// allocation tracking:
+// ============================================================
+
+static std::atomic<size_t> allocCount{ 0 };
+static std::atomic<size_t> allocBytes{ 0 };
+static std::atomic<size_t> liveBytes{ 0 };
+static std::atomic<size_t> peakBytes{ 0 };
+
+/// Every allocation is prefixed with its size, to track live bytes.
+static constexpr size_t ALLOC_HEADER = alignof(std::max_align_t);
+
+/// Count an allocation of `size` bytes.
+static void trackAlloc(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    const size_t live =
+        liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = peakBytes.load(std::memory_order_relaxed);
+    while (live > peak
+           && !peakBytes.compare_exchange_weak(
+               peak, live, std::memory_order_relaxed
+           ))
+    {
+    }
+}
+
+// The replaced operators free() what they malloc(), seen by GCC as new/free.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    auto ptr = static_cast<char*>(std::malloc(size + ALLOC_HEADER));
+    if (!ptr) throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(ptr) = size;
+    trackAlloc(size);
+    return ptr + ALLOC_HEADER;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    const auto base = static_cast<char*>(ptr) - ALLOC_HEADER;
+    liveBytes.fetch_sub(
+        *reinterpret_cast<size_t*>(base), std::memory_order_relaxed
+    );
+    std::free(base);
+}
+
+void operator delete(void* ptr, size_t) noexcept { operator delete(ptr); }
+
+// std::pmr::new_delete_resource() allocates with alignment.
+void* operator new(size_t size, std::align_val_t align) {
+    const size_t header = std::max(ALLOC_HEADER, size_t(align));
+    const size_t total = (size + 2 * header - 1) / header * header;
+    auto ptr = static_cast<char*>(std::aligned_alloc(size_t(align), total));
+    if (!ptr) throw std::bad_alloc();
+    *reinterpret_cast<size_t*>(ptr + header - sizeof(size_t)) = size;
+    trackAlloc(size);
+    return ptr + header;
+}
+
+void operator delete(void* ptr, std::align_val_t align) noexcept {
+    if (!ptr) return;
+    const size_t header = std::max(ALLOC_HEADER, size_t(align));
+    const auto base = static_cast<char*>(ptr) - header;
+    liveBytes.fetch_sub(
+        *reinterpret_cast<size_t*>(base + header - sizeof(size_t)),
+        std::memory_order_relaxed
+    );
+    std::free(base);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept {
+    operator delete(ptr, align);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+// ============================================================
+// inputs:
+// ============================================================
+
+/// Parse a size like "1024", "16K" or "100M".
+static size_t parseSize(const std::string& str) {
+    size_t pos = 0;
+    size_t size = std::stoul(str, &pos);
+    if (pos < str.size()) {
+        switch (str[pos]) {
+            case 'K': case 'k': size <<= 10; break;
+            case 'M': case 'm': size <<= 20; break;
+            case 'G': case 'g': size <<= 30; break;
+        }
+    }
+    return size;
+}
+
+static std::string sizeName(size_t size) {
+    if (size >= (1u << 20)) return std::to_string(size >> 20) + "M";
+    if (size >= (1u << 10)) return std::to_string(size >> 10) + "K";
+    return std::to_string(size);
+}
+
+/// Realistic JSON config of about `size` bytes, with one object per tenant.
+static std::string makeTenantsJson(size_t size) {
+    std::string json = "{\n  \"service\": \"c2p\",\n  \"tenants\": [\n";
+    for (size_t idx = 0; json.size() < size; ++idx) {
+        const std::string id = std::to_string(idx);
+        if (idx > 0) json += ",\n";
+        json += "    {\n"
+                "      \"id\": " + id + ",\n"
+                "      \"name\": \"tenant-" + id + "\",\n"
+                "      \"enable\": true,\n"
+                "      \"port\": " + std::to_string(8000 + idx % 1000) + ",\n"
+                "      \"timeout\": 1.5,\n"
+                "      \"tags\": [\"a\", \"b\", null],\n"
+                "      \"limits\": { \"cpu\": 2, \"mem\": \"4Gi\" }\n"
+                "    }";
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+/// Newline-delimited JSON of about `size` bytes, one tenant per line.
+static std::string makeTenantsLines(size_t size) {
+    std::string lines;
+    for (size_t idx = 0; lines.size() < size; ++idx) {
+        const std::string id = std::to_string(idx);
+        lines += "{\"id\": " + id + ", \"name\": \"tenant-" + id + "\", "
+                 "\"enable\": true, \"port\": "
+               + std::to_string(8000 + idx % 1000) + ", \"timeout\": 1.5, "
+                 "\"tags\": [\"a\", \"b\", null], "
+                 "\"limits\": {\"cpu\": 2, \"mem\": \"4Gi\"}}\n";
+    }
+    return lines;
+}
+
+/// Synthetic JSON of about `size` bytes, mostly long strings.
+static std::string makeStringsJson(size_t size) {
+    const std::string text =
+        "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+        "eiusmod tempor incididunt ut labore et dolore magna aliqua.";
+    std::string json = "[";
+    for (size_t idx = 0; json.size() < size; ++idx) {
+        if (idx > 0) json += ",";
+        json += "\"" + text + "\\n" + std::to_string(idx) + "\"";
+    }
+    json += "]";
+    return json;
+}
+
+/// Synthetic JSON of about `size` bytes, mostly numbers.
+static std::string makeNumbersJson(size_t size) {
+    std::string json = "[";
+    for (size_t idx = 0; json.size() < size; ++idx) {
+        if (idx > 0) json += ",";
+        json += "[" + std::to_string(idx) + ",-" + std::to_string(idx % 97)
+              + ".25,1e3,true,null]";
+    }
+    json += "]";
+    return json;
+}
+
+/// Synthetic JSON of about `size` bytes, of chains of arrays and objects
+/// nested 512 levels deep.
+static std::string makeDeepJson(size_t size) {
+    constexpr size_t DEPTH = 512;
+    std::string json = "[";
+    for (size_t idx = 0; json.size() < size; ++idx) {
+        if (idx > 0) json += ",";
+        for (size_t level = 0; level < DEPTH; ++level) {
+            json += level % 2 ? "[" : "{\"a\":";
+        }
+        json += std::to_string(idx);
+        for (size_t level = DEPTH; level-- > 0;) {
+            json += level % 2 ? "]" : "}";
+        }
+    }
+    json += "]";
+    return json;
+}
+
+/// Realistic INI config of about `size` bytes, with one section per tenant.
+static std::string makeTenantsIni(size_t size) {
+    std::string ini = "service = c2p\n";
+    for (size_t idx = 0; ini.size() < size; ++idx) {
+        const std::string id = std::to_string(idx);
+        ini += "\n[tenant-" + id + "]\n"
+               "id = " + id + "\n"
+               "enable = true\n"
+               "port = " + std::to_string(8000 + idx % 1000) + "\n"
+               "timeout = 1.5\n"
+               "mem = \"4Gi\"\n";
+    }
+    return ini;
+}
+
+/// Command line arguments of about `size` bytes.
+static std::vector<std::string> makeArgs(size_t size) {
+    std::vector<std::string> args = { "server" };
+    size_t total = 0;
+    for (size_t idx = 0; total < size; ++idx) {
+        switch (idx % 4) {
+            case 0: args.push_back("-v"); break;
+            case 1: {
+                args.push_back("--input");
+                args.push_back("file-" + std::to_string(idx));
+            } break;
+            case 2: {
+                args.push_back("--port");
+                args.push_back("8080");
+            } break;
+            case 3: args.push_back("position-" + std::to_string(idx)); break;
+        }
+        total += args.back().size() + 1;
+    }
+    return args;
+}
+
+static c2p::cli::Parser makeCliParser() {
+    using namespace c2p;
+    // All fields without defaults are set, so that -Wextra does NOT warn.
+    return *cli::Parser::constructFrom(cli::CommandGroup{
+        .command = "server",
+        .description = "Serve the input files.",
+        .flagArgs = {
+            {
+                .name = "verbose",
+                .shortName = 'v',
+                .description = "Log more.",
+            },
+        },
+        .valueArgs = {
+            {
+                .name = "input",
+                .shortName = 'i',
+                .typeTag = TypeTag::STRING,
+                .defaultValue = std::nullopt,
+                .multiple = true,
+                .description = "Input file.",
+            },
+            {
+                .name = "port",
+                .shortName = 'p',
+                .typeTag = TypeTag::NUMBER,
+                .defaultValue = std::nullopt,
+                .multiple = true,
+                .description = "Port to listen on.",
+            },
+        },
+        .maxPositionalArgNum = UINT32_MAX,
+        .positionalArgDescription = "More input files.",
+        .subCommands = {},
+    });
+}
+
+// ============================================================
+// running:
+// ============================================================
+
+struct Options {
+    size_t maxSize = 16u << 20;
+    std::string filter;
+    double minTime = 0.2;
+};
+
+/// Run `func` repeatedly for at least `options.minTime` seconds, and print
+/// the result as one JSON line. `inputSize` is the size of the input of one
+/// operation, or 0 if not meaningful.
+template <typename Func>
+static void run(
+    const Options& options,
+    const std::string& name,
+    const std::string& input,
+    size_t inputSize,
+    Func&& func
+) {
+    if (name.find(options.filter) == std::string::npos) return;
+
+    const size_t liveStart = liveBytes.load();
+    peakBytes.store(liveStart);
+    const size_t countStart = allocCount.load();
+    const size_t bytesStart = allocBytes.load();
+
+    size_t iterations = 0;
+    double seconds = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t batch = 1; seconds < options.minTime; batch *= 2) {
+        for (size_t iter = 0; iter < batch; ++iter) {
+            func();
+        }
+        iterations += batch;
+        seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - start
+        )
+                      .count();
+    }
+
+    const double allocs = double(allocCount.load() - countStart);
+    const double bytes = double(allocBytes.load() - bytesStart);
+    std::printf(
+        "{\"case\":\"%s\",\"input\":\"%s\",\"size\":%zu,"
+        "\"iterations\":%zu,\"seconds\":%.6f,\"ops_per_s\":%.3f,"
+        "\"mb_per_s\":%.3f,\"allocs_per_op\":%.2f,"
+        "\"alloc_bytes_per_op\":%.1f,\"peak_bytes\":%zu}\n",
+        name.c_str(),
+        input.c_str(),
+        inputSize,
+        iterations,
+        seconds,
+        iterations / seconds,
+        double(inputSize) * iterations / seconds / 1e6,
+        allocs / iterations,
+        bytes / iterations,
+        peakBytes.load() - liveStart
+    );
+    std::fflush(stdout);
+}
+
+/// Config of the doTransform case, reading fields of every tenant.
+struct TenantsConfig: public c2p::Config {
+    c2p::ValueTree tree;
+};
+
+struct TenantsParam: public c2p::Param {
+    std::vector<int64_t> ports;
+    std::vector<std::string> names;
+};
+
+static std::vector<c2p::Rule> makeRules() {
+    using namespace c2p;
+    return {
+        Rule{
+            .description = "Collect enabled ports.",
+            .transform =
+                [](auto& config, auto& param, auto&) {
+                    auto& tree = static_cast<const TenantsConfig&>(config).tree;
+                    auto& ports = static_cast<TenantsParam&>(param).ports;
+                    const auto tenants = tree.getArray("tenants");
+                    if (!tenants) return false;
+                    ports.clear();
+                    for (const auto& tenant: *tenants) {
+                        if (tenant.value<TypeTag::BOOL>("enable") != true) {
+                            continue;
+                        }
+                        const auto port = tenant.value<TypeTag::INTEGER>("port");
+                        if (!port) return false;
+                        ports.push_back(*port);
+                    }
+                    return true;
+                },
+        },
+        Rule{
+            .description = "Collect names.",
+            .transform =
+                [](auto& config, auto& param, auto&) {
+                    auto& tree = static_cast<const TenantsConfig&>(config).tree;
+                    auto& names = static_cast<TenantsParam&>(param).names;
+                    const auto tenants = tree.getArray("tenants");
+                    if (!tenants) return false;
+                    names.clear();
+                    for (const auto& tenant: *tenants) {
+                        const auto name = tenant.value<TypeTag::STRING>("name");
+                        if (!name) return false;
+                        names.push_back(*name);
+                    }
+                    return true;
+                },
+        },
+    };
+}
+
+/// Counts the values of a JSON document, like a consumer streaming through it.
+struct JsonCounter: public c2p::json::Handler {
+    size_t values = 0;
+
+    bool value(const c2p::ValueNode&) override {
+        ++values;
+        return true;
+    }
+};
+
+/// Counts the entries of an INI document.
+struct IniCounter: public c2p::ini::Handler {
+    size_t entries = 0;
+
+    bool entry(std::string_view, std::string_view) override {
+        ++entries;
+        return true;
+    }
+};
+
+static void runJson(const Options& options, size_t size) {
+    const std::vector<std::pair<std::string, std::string>> inputs = {
+        { "tenants", makeTenantsJson(size) },
+        { "strings", makeStringsJson(size) },
+        { "numbers", makeNumbersJson(size) },
+        { "deep", makeDeepJson(size) },
+    };
+    for (const auto& [input, json]: inputs) {
+        run(options, "json_parse", input, json.size(), [&]() {
+            const auto tree = c2p::json::parse(json);
+        });
+        run(options, "json_events", input, json.size(), [&]() {
+            JsonCounter counter;
+            if (!c2p::json::parse(json, counter)) std::abort();
+        });
+        c2p::ValueTree reloaded = c2p::json::parse(json);
+        run(options, "json_parse_into", input, json.size(), [&]() {
+            if (!c2p::json::parseInto(reloaded, json)) std::abort();
+        });
+        run(options, "json_push", input, json.size(), [&]() {
+            constexpr size_t CHUNK_SIZE = 64 * 1024;
+            c2p::json::PushParser parser;
+            for (size_t pos = 0; pos < json.size(); pos += CHUNK_SIZE) {
+                const size_t size = std::min(CHUNK_SIZE, json.size() - pos);
+                if (!parser.feed(json.data() + pos, size)) std::abort();
+            }
+            const auto tree = parser.finish();
+        });
+        const auto tree = c2p::json::parse(json);
+
+        // 1-of-N access: the middle element of the main array.
+        const auto array =
+            tree.isArray() ? tree.getArray() : tree.getArray("tenants");
+        const auto middle = tree.isArray()
+                              ? c2p::Path::from(array->size() / 2)
+                              : c2p::Path::from("tenants", array->size() / 2);
+        run(options, "json_lazy_one", input, json.size(), [&]() {
+            auto document = c2p::json::LazyDocument::index(json);
+            if (!document || !document->subTree(middle)) std::abort();
+        });
+        run(options, "tree_copy", input, json.size(), [&]() {
+            const auto copy = tree;
+        });
+        run(options, "json_dump", input, json.size(), [&]() {
+            const auto str = c2p::json::dump(tree);
+        });
+        run(options, "json_dump_pretty", input, json.size(), [&]() {
+            const auto str = c2p::json::dump(tree, true);
+        });
+
+        // Parsing a file: read into a string first, or parse the mapping.
+        const std::string path =
+            (std::filesystem::temp_directory_path() / "c2p_benchmark.json")
+                .string();
+        run(options, "json_dump_file", input, json.size(), [&]() {
+            if (!c2p::json::dumpFile(tree, path)) std::abort();
+        });
+        run(options, "json_read_parse", input, json.size(), [&]() {
+            std::FILE* file = std::fopen(path.c_str(), "rb");
+            if (!file) std::abort();
+            std::string str(std::filesystem::file_size(path), '\0');
+            const size_t read = std::fread(str.data(), 1, str.size(), file);
+            std::fclose(file);
+            if (read != str.size()) std::abort();
+            const auto tree = c2p::json::parse(str);
+        });
+        run(options, "json_parse_file", input, json.size(), [&]() {
+            const auto tree = c2p::json::parseFile(path);
+        });
+        std::filesystem::remove(path);
+    }
+}
+
+static void runJsonLines(const Options& options, size_t size) {
+    const auto lines = makeTenantsLines(size);
+    for (const size_t threads: { 1, 2, 4, 8 }) {
+        const std::string input = "tenants_t" + std::to_string(threads);
+        c2p::json::ParseOptions parseOptions;
+        parseOptions.threads = threads;
+        run(options, "json_lines", input, lines.size(), [&]() {
+            const auto trees = c2p::json::parseLines(lines, parseOptions);
+        });
+    }
+}
+
+static void runJsonParallel(const Options& options, size_t size) {
+    const std::vector<std::pair<std::string, std::string>> inputs = {
+        { "strings", makeStringsJson(size) },
+        { "numbers", makeNumbersJson(size) },
+    };
+    for (const auto& [name, json]: inputs) {
+        for (const size_t threads: { 1, 2, 4, 8 }) {
+            const std::string input = name + "_t" + std::to_string(threads);
+            c2p::json::ParseOptions parseOptions;
+            parseOptions.threads = threads;
+            run(options, "json_parse_parallel", input, json.size(), [&]() {
+                const auto tree = c2p::json::parse(json, parseOptions);
+            });
+        }
+    }
+}
+
+static void runIni(const Options& options, size_t size) {
+    const auto ini = makeTenantsIni(size);
+    run(options, "ini_parse", "tenants", ini.size(), [&]() {
+        const auto tree = c2p::ini::parse(ini);
+    });
+    run(options, "ini_events", "tenants", ini.size(), [&]() {
+        IniCounter counter;
+        if (!c2p::ini::parse(ini, counter)) std::abort();
+    });
+    c2p::ValueTree reloaded = c2p::ini::parse(ini);
+    run(options, "ini_parse_into", "tenants", ini.size(), [&]() {
+        if (!c2p::ini::parseInto(reloaded, ini)) std::abort();
+    });
+    const auto tree = c2p::ini::parse(ini);
+    run(options, "ini_dump", "tenants", ini.size(), [&]() {
+        const auto str = c2p::ini::dump(tree);
+    });
+}
+
+static void runCli(const Options& options, size_t size) {
+    const auto args = makeArgs(size);
+    std::vector<const char*> argv;
+    size_t argsSize = 0;
+    for (const auto& arg: args) {
+        argv.push_back(arg.c_str());
+        argsSize += arg.size() + 1;
+    }
+    const auto parser = makeCliParser();
+    if (!parser.parse(int(argv.size()), argv.data())) std::abort();
+    run(options, "cli_parse", "args", argsSize, [&]() {
+        const auto tree = parser.parse(int(argv.size()), argv.data());
+    });
+}
+
+static void runTree(const Options& options, size_t size) {
+    const auto json = makeTenantsJson(size);
+    const auto tree = c2p::json::parse(json);
+    const size_t tenantCount = tree.getArray("tenants")->size();
+
+    // One operation looks up one field of every tenant.
+    run(options, "tree_lookup", "tenants", json.size(), [&]() {
+        int64_t sum = 0;
+        for (size_t idx = 0; idx < tenantCount; ++idx) {
+            sum += *tree.value<c2p::TypeTag::INTEGER>("tenants", idx, "port");
+        }
+        if (sum == 0) std::abort();
+    });
+
+    run(options, "freeze", "tenants", json.size(), [&]() {
+        const c2p::FrozenTree frozen(tree);
+    });
+
+    // The same lookups as "tree_lookup", in a FrozenTree.
+    const c2p::FrozenTree frozen(tree);
+    run(options, "frozen_lookup", "tenants", json.size(), [&]() {
+        int64_t sum = 0;
+        for (size_t idx = 0; idx < tenantCount; ++idx) {
+            sum += *frozen.value<c2p::TypeTag::INTEGER>("tenants", idx, "port");
+        }
+        if (sum == 0) std::abort();
+    });
+
+    // Startup from a snapshot file: load it and look up one value.
+    const std::string snapshotPath =
+        (std::filesystem::temp_directory_path() / "c2p_benchmark.snap")
+            .string();
+    if (!c2p::snapshot::write(frozen, snapshotPath)) std::abort();
+    run(options, "snapshot_load", "tenants", json.size(), [&]() {
+        const auto loaded = c2p::snapshot::load(snapshotPath);
+        if (!loaded || !loaded->value<c2p::TypeTag::STRING>("service")) {
+            std::abort();
+        }
+    });
+    std::filesystem::remove(snapshotPath);
+
+    const auto service = c2p::Path::from("service");
+    run(options, "tree_lookup_path", "tenants", 0, [&]() {
+        if (!tree.value<c2p::TypeTag::STRING>(service)) std::abort();
+    });
+
+    // One operation makes snapshots of the tree which differ in a few keys,
+    // and keeps them alive together, like per-request config overrides.
+    const auto makeSnapshots = [tenantCount](const c2p::ValueTree& source) {
+        std::vector<c2p::ValueTree> snapshots(16, source);
+        for (size_t idx = 0; idx < snapshots.size(); ++idx) {
+            auto& snapshot = snapshots[idx];
+            snapshot["service"] = "snapshot-" + std::to_string(idx);
+            auto& tenant = snapshot["tenants"].asArray()[idx % tenantCount];
+            tenant["port"] = 9000 + idx;
+            tenant["limits"]["cpu"] = 4;
+        }
+    };
+    run(options, "snapshots_deep", "tenants", json.size(), [&]() {
+        makeSnapshots(tree);
+    });
+    auto sharedTree = tree;
+    sharedTree.share();
+    run(options, "snapshots_shared", "tenants", json.size(), [&]() {
+        makeSnapshots(sharedTree);
+    });
+
+    // One operation diffs the tree with a copy of it modified at one key,
+    // like a reloaded config. Hashes of both trees stay cached.
+    auto modified = tree;
+    modified["tenants"].asArray()[tenantCount / 2]["port"] = 1;
+    c2p::SubtreeHashes hashes;
+    run(options, "tree_diff", "tenants", json.size(), [&]() {
+        if (c2p::diff(tree, modified, hashes).size() != 1) std::abort();
+    });
+
+    run(options, "tree_hash", "tenants", json.size(), [&]() {
+        if (c2p::hash(tree) == 0) std::abort();
+    });
+
+    // One operation modifies one tenant and hashes the whole tree again, like
+    // a check whether a live config has changed.
+    auto live = tree;
+    c2p::SubtreeHashes liveHashes;
+    liveHashes.hash(live);
+    int64_t port = 0;
+    run(options, "tree_hash_cached", "tenants", json.size(), [&]() {
+        live["tenants"].asArray()[tenantCount / 2]["port"] = ++port;
+        if (liveHashes.hash(live) == 0) std::abort();
+    });
+
+    // One operation merges the tree, a moved copy of it and a small override,
+    // like defaults, a config file and CLI arguments.
+    const auto override = c2p::json::parse(R"({"service":"cli"})");
+    run(options, "merge", "tenants", json.size(), [&]() {
+        const auto merged = c2p::merge({ tree, c2p::ValueTree(tree), override });
+    });
+
+    TenantsConfig config;
+    config.tree = tree;
+    TenantsParam param;
+    const auto rules = makeRules();
+    run(options, "transform", "tenants", json.size(), [&]() {
+        if (!c2p::doTransform(config, param, rules)) std::abort();
+    });
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int idx = 1; idx < argc; ++idx) {
+        const std::string arg = argv[idx];
+        const auto eq = arg.find('=');
+        const auto name = arg.substr(0, eq);
+        const auto value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (name == "--max-size") {
+            options.maxSize = parseSize(value);
+        } else if (name == "--filter") {
+            options.filter = value;
+        } else if (name == "--min-time") {
+            options.minTime = std::stod(value);
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (const size_t size: { 1u << 10, 64u << 10, 1u << 20, 16u << 20,
+                              100u << 20 })
+    {
+        if (size > options.maxSize) break;
+        std::cerr << "size: " << sizeName(size) << std::endl;
+        runJson(options, size);
+        runJsonLines(options, size);
+        runJsonParallel(options, size);
+        runIni(options, size);
+        // Command lines beyond 1 MB are not realistic.
+        if (size <= (1u << 20)) runCli(options, size);
+        runTree(options, size);
+    }
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    std::printf("{\"max_rss_bytes\":%ld}\n", usage.ru_maxrss * 1024L);
+}
@@ -162,8 +162,8 @@ int main(int argc, char* argv[]) {
             "valueArgs": {
                 "input": "~/input.ini",
                 "nums": [
-                    1000,
-                    123
+                    1000.0,
+                    123.0
                 ],
                 "output": "./output.exe"
             }
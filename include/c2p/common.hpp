@@ -6,8 +6,13 @@
 #ifndef __C2P_COMMON_HPP__
 #define __C2P_COMMON_HPP__
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 
 namespace c2p {
 
@@ -55,6 +60,91 @@ struct Logger {
     // clang-format on
 };
 
+/// Output destination of serialization.
+///
+/// Output is written into a preallocated buffer and handed over in chunks:
+/// - `Sink(std::string&)`: append to a string, growing it as needed.
+/// - `Sink(std::FILE*)`: write to a file.
+/// - `Sink(WriteCallback)`: pass to a callback, e.g. for a file descriptor.
+///
+/// Output is complete after `flush()` or destruction of the sink.
+class Sink
+{
+  public:
+
+    using WriteCallback = std::function<void(const char* data, size_t size)>;
+
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    /// Append output to `output`.
+    explicit Sink(std::string& output);
+
+    /// Write output to `file`. The file is not closed by the sink.
+    explicit Sink(std::FILE* file, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+    /// Pass output to `writeCallback` whenever the buffer is full.
+    explicit Sink(
+        WriteCallback writeCallback,
+        size_t bufferSize = DEFAULT_BUFFER_SIZE
+    );
+
+    Sink(const Sink&) = delete;
+    Sink& operator=(const Sink&) = delete;
+
+    ~Sink() { flush(); }
+
+    /// Write one character.
+    void put(char c) {
+        if (_cursor == _limit) _overflow(1);
+        *_cursor++ = c;
+    }
+
+    /// Write `size` characters from `data`.
+    void write(const char* data, size_t size) {
+        if (size > size_t(_limit - _cursor)) {
+            _overflow(size);
+            // Large chunks may be handed over directly.
+            if (size > size_t(_limit - _cursor)) {
+                _writeCallback(data, size);
+                return;
+            }
+        }
+        std::memcpy(_cursor, data, size);
+        _cursor += size;
+    }
+
+    /// Write a string.
+    void write(std::string_view str) { write(str.data(), str.size()); }
+
+    /// Write `count` copies of `c`.
+    void fill(char c, size_t count) {
+        while (count > 0) {
+            if (_cursor == _limit) _overflow(count);
+            const size_t n = std::min(count, size_t(_limit - _cursor));
+            std::memset(_cursor, c, n);
+            _cursor += n;
+            count -= n;
+        }
+    }
+
+    /// Hand over all buffered output.
+    void flush();
+
+  private:
+
+    /// Make room for at least `required` characters if possible.
+    void _overflow(size_t required);
+
+    /// The string written to directly, or nullptr.
+    std::string* _output = nullptr;
+    WriteCallback _writeCallback;
+    std::unique_ptr<char[]> _buffer;
+    size_t _bufferSize = 0;
+    char* _begin = nullptr;
+    char* _cursor = nullptr;
+    char* _limit = nullptr;
+};
+
 extern const std::string ProjectVersion;
 extern const std::string ProjectGitCommit;
 extern const std::string ProjectGitBranch;
@@ -0,0 +1,69 @@
+/**
+ * @file diff.hpp
+ * @brief Structural diff between two ValueTrees, e.g. to reload only the
+ * changed parts of a config. Based on ValueTree.
+ */
+
+#ifndef __C2P_DIFF_HPP__
+#define __C2P_DIFF_HPP__
+
+#include <c2p/hash.hpp>
+#include <c2p/value_tree.hpp>
+#include <vector>
+
+namespace c2p {
+
+/// One difference found by `diff`.
+struct Change {
+
+    enum class Kind {
+        ADDED,    ///< Only the new tree has the path.
+        REMOVED,  ///< Only the old tree has the path.
+        CHANGED,  ///< Both trees have the path, with different subtrees.
+    };
+
+    Kind kind;
+
+    /// Path from the root to the added, removed or changed subtree.
+    Path path;
+};
+
+/// Convert Change::Kind to string.
+inline std::string to_string(Change::Kind kind) {
+    switch (kind) {
+        case Change::Kind::ADDED: return "ADDED";
+        case Change::Kind::REMOVED: return "REMOVED";
+        case Change::Kind::CHANGED: return "CHANGED";
+        default: return "UNKNOWN";
+    }
+}
+
+/// Find the differences from tree `from` to tree `to`.
+///
+/// Objects are compared key by key, and arrays index by index, e.g. an
+/// element inserted in the middle of an array changes all elements after
+/// it. A subtree which differs in state, or in value, is one CHANGED path,
+/// its subtrees are NOT reported. Empty subtrees count as absent, also in
+/// arrays, whose indices count only the non-empty elements, the same as in
+/// `json::dump`.
+///
+/// Subtrees with equal hashes are skipped without visiting them, and so are
+/// subtrees shared by both trees, see `ValueTree::share()`. Hashes are 64
+/// bits, so different subtrees are very unlikely to be taken as equal.
+///
+/// Hashes cached in `hashes` are only checked by the generations of the
+/// trees, so a subtree modified through a reference kept from an earlier
+/// call may be taken as unchanged, see `SubtreeHashes` for the `touch()`
+/// calls needed after such modifications.
+std::vector<Change> diff(
+    const ValueTree& from,
+    const ValueTree& to,
+    SubtreeHashes& hashes
+);
+
+/// Same as above, with hashes which are NOT cached between calls.
+std::vector<Change> diff(const ValueTree& from, const ValueTree& to);
+
+}  // namespace c2p
+
+#endif  // __C2P_DIFF_HPP__
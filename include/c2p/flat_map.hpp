@@ -0,0 +1,323 @@
+/**
+ * @file flat_map.hpp
+ * @brief Flat hash map with string keys, keeping insertion order.
+ */
+
+#ifndef __C2P_FLAT_MAP_HPP__
+#define __C2P_FLAT_MAP_HPP__
+
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace c2p {
+
+/// Map from string `Key` to `T`, stored in one contiguous array in insertion
+/// order, plus an open-addressing hash index for lookup.
+///
+/// `Key` is std::string, or another string type convertible to
+/// std::string_view, e.g. `InternedKey`. If it has a member `hash()`, the
+/// hash is taken from the key instead of being computed, and lookups with a
+/// `Key` compare keys with its own `operator==`.
+///
+/// Interface is a subset of `std::map`. Lookup accepts any key convertible
+/// to std::string_view without allocation. Differences from `std::map`:
+/// - Iteration follows insertion order.
+/// - Inserting may invalidate iterators and references to elements.
+/// - Erasing is O(n).
+/// - Keys must NOT be modified through iterators.
+///
+/// Small maps are searched linearly. The hash index is built when the map
+/// grows beyond `LINEAR_SEARCH_LIMIT` elements.
+template <typename T, typename Key = std::string>
+class FlatMap
+{
+  public:
+
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<Key, T>;
+    using size_type = size_t;
+    using allocator_type = std::pmr::polymorphic_allocator<value_type>;
+    using iterator = typename std::pmr::vector<value_type>::iterator;
+    using const_iterator =
+        typename std::pmr::vector<value_type>::const_iterator;
+
+    static constexpr size_t LINEAR_SEARCH_LIMIT = 8;
+
+    FlatMap() = default;
+
+    /// Allocate elements and index from `resource`.
+    explicit FlatMap(std::pmr::memory_resource* resource)
+        : _entries(resource), _slots(resource) {}
+
+    /// Copies allocate from the default resource, as std::pmr containers do.
+    FlatMap(const FlatMap&) = default;
+    FlatMap(FlatMap&&) = default;
+    FlatMap& operator=(const FlatMap&) = default;
+    FlatMap& operator=(FlatMap&&) = default;
+
+    ~FlatMap() = default;
+
+    allocator_type get_allocator() const { return _entries.get_allocator(); }
+
+  public:
+
+    iterator begin() { return _entries.begin(); }
+    iterator end() { return _entries.end(); }
+    const_iterator begin() const { return _entries.begin(); }
+    const_iterator end() const { return _entries.end(); }
+    const_iterator cbegin() const { return _entries.cbegin(); }
+    const_iterator cend() const { return _entries.cend(); }
+
+    size_t size() const { return _entries.size(); }
+    bool empty() const { return _entries.empty(); }
+
+    /// Reserve space for `count` elements, and for their index if needed.
+    void reserve(size_t count) {
+        _entries.reserve(count);
+        if (count > LINEAR_SEARCH_LIMIT && _slotCapacity() < count * 2) {
+            _rehash(count * 2);
+        }
+    }
+
+    void clear() {
+        _entries.clear();
+        _slots.clear();
+    }
+
+  public:
+
+    /// Find element with `key`. Return `end()` if not found.
+    template <typename K>
+    iterator find(const K& key) {
+        return _entries.begin() + _findIndex(_lookupKey(key));
+    }
+
+    /// Find element with `key`. Return `end()` if not found.
+    template <typename K>
+    const_iterator find(const K& key) const {
+        return _entries.begin() + _findIndex(_lookupKey(key));
+    }
+
+    template <typename K>
+    size_t count(const K& key) const {
+        return _findIndex(_lookupKey(key)) != _entries.size() ? 1 : 0;
+    }
+
+    template <typename K>
+    bool contains(const K& key) const {
+        return count(key) != 0;
+    }
+
+    /// Get element with `key`. Throw std::out_of_range if not found.
+    template <typename K>
+    T& at(const K& key) {
+        const auto it = find(key);
+        if (it == end()) throw std::out_of_range("c2p::FlatMap::at");
+        return it->second;
+    }
+
+    /// Get element with `key`. Throw std::out_of_range if not found.
+    template <typename K>
+    const T& at(const K& key) const {
+        const auto it = find(key);
+        if (it == end()) throw std::out_of_range("c2p::FlatMap::at");
+        return it->second;
+    }
+
+    /// Get element with `key`, inserting a default one if not found.
+    /// The key is only copied when inserting.
+    template <typename K>
+    T& operator[](K&& key) {
+        return try_emplace(std::forward<K>(key)).first->second;
+    }
+
+    /// Insert an element constructed from `args` if `key` is not found.
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        const auto& lookupKey = _lookupKey(key);
+        const size_t hash = _slots.empty() ? 0 : _hash(lookupKey);
+        const size_t index = _findIndex(lookupKey, hash);
+        if (index != _entries.size()) {
+            return { _entries.begin() + index, false };
+        }
+        _entries.emplace_back(
+            std::piecewise_construct,
+            std::forward_as_tuple(std::forward<K>(key)),
+            std::forward_as_tuple(std::forward<Args>(args)...)
+        );
+        _indexBack(hash);
+        return { _entries.end() - 1, true };
+    }
+
+    /// Insert `value` if its key is not found.
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return try_emplace(value.first, value.second);
+    }
+
+    /// Insert `value` if its key is not found.
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return try_emplace(std::move(value.first), std::move(value.second));
+    }
+
+    /// Insert an element with `key` and `value` if `key` is not found.
+    template <typename K, typename V>
+    std::pair<iterator, bool> emplace(K&& key, V&& value) {
+        return try_emplace(std::forward<K>(key), std::forward<V>(value));
+    }
+
+    /// Same as `emplace`, for compatibility with `std::map`. The hint is not
+    /// used.
+    template <typename K, typename V>
+    iterator emplace_hint(const_iterator, K&& key, V&& value) {
+        return emplace(std::forward<K>(key), std::forward<V>(value)).first;
+    }
+
+    /// Erase element at `pos`. Return iterator to the following element.
+    iterator erase(const_iterator pos) {
+        const size_t index = pos - _entries.cbegin();
+        _entries.erase(_entries.begin() + index);
+        if (!_slots.empty()) _rehash(_slotCapacity());
+        return _entries.begin() + index;
+    }
+
+    /// Erase element with `key`. Return the number of erased elements.
+    template <
+        typename K,
+        typename = std::enable_if_t<!std::is_convertible_v<K, const_iterator>>>
+    size_t erase(const K& key) {
+        const auto it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    bool operator==(const FlatMap& other) const {
+        if (size() != other.size()) return false;
+        for (const auto& [key, value]: _entries) {
+            const auto it = other.find(key);
+            if (it == other.end() || !(it->second == value)) return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const FlatMap& other) const { return !(*this == other); }
+
+  private:
+
+    /// One slot of the hash index. `index` is the element index plus 1, 0
+    /// means an empty slot. `hash` is the low bits of the key hash, used to
+    /// skip most key comparisons.
+    struct Slot {
+        uint32_t index;
+        uint32_t hash;
+    };
+
+    /// If `Key` has a member `hash()`.
+    template <typename K, typename = void>
+    struct _HasHash: std::false_type {};
+
+    template <typename K>
+    struct _HasHash<K, std::void_t<decltype(std::declval<const K&>().hash())>>
+        : std::true_type {};
+
+    /// Look up with a `Key` as it is, and with any other string as a
+    /// std::string_view.
+    template <typename K>
+    static decltype(auto) _lookupKey(const K& key) {
+        if constexpr (std::is_same_v<K, Key>) {
+            return key;
+        } else {
+            return std::string_view(key);
+        }
+    }
+
+    static size_t _hash(std::string_view key) {
+        return std::hash<std::string_view>()(key);
+    }
+
+    template <
+        typename K = Key,
+        typename = std::enable_if_t<_HasHash<K>::value>>
+    static size_t _hash(const Key& key) {
+        return key.hash();
+    }
+
+    size_t _slotCapacity() const { return _slots.size(); }
+
+    template <typename K>
+    size_t _findIndex(const K& key) const {
+        return _findIndex(key, _slots.empty() ? 0 : _hash(key));
+    }
+
+    /// Find the element index of `key`, or `size()` if not found.
+    template <typename K>
+    size_t _findIndex(const K& key, size_t hash) const {
+        if (_slots.empty()) {
+            for (size_t i = 0; i < _entries.size(); ++i) {
+                if (_entries[i].first == key) return i;
+            }
+            return _entries.size();
+        }
+        const size_t mask = _slotCapacity() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const auto& slot = _slots[i];
+            if (slot.index == 0) return _entries.size();
+            if (slot.hash == uint32_t(hash)
+                && _entries[slot.index - 1].first == key)
+            {
+                return slot.index - 1;
+            }
+        }
+    }
+
+    /// Add the last element to the hash index, growing it if needed.
+    void _indexBack(size_t hash) {
+        if (_slots.empty()) {
+            if (_entries.size() > LINEAR_SEARCH_LIMIT) {
+                _rehash(_entries.size() * 2);
+            }
+            return;
+        }
+        // Keep the load factor no more than 1/2.
+        if (_entries.size() * 2 > _slotCapacity()) {
+            _rehash(_slotCapacity() * 2);
+            return;
+        }
+        _insertSlot(uint32_t(_entries.size()), hash);
+    }
+
+    void _insertSlot(uint32_t index, size_t hash) {
+        const size_t mask = _slotCapacity() - 1;
+        size_t i = hash & mask;
+        while (_slots[i].index != 0) i = (i + 1) & mask;
+        _slots[i] = { index, uint32_t(hash) };
+    }
+
+    /// Rebuild the hash index with at least `capacity` slots.
+    void _rehash(size_t capacity) {
+        size_t slotCapacity = 16;
+        while (slotCapacity < capacity) slotCapacity *= 2;
+        _slots.assign(slotCapacity, Slot{ 0, 0 });
+        for (size_t i = 0; i < _entries.size(); ++i) {
+            _insertSlot(uint32_t(i + 1), _hash(_entries[i].first));
+        }
+    }
+
+    std::pmr::vector<value_type> _entries;
+
+    /// Empty while the map is searched linearly, otherwise a power of 2.
+    std::pmr::vector<Slot> _slots;
+};
+
+}  // namespace c2p
+
+#endif  // __C2P_FLAT_MAP_HPP__
@@ -0,0 +1,577 @@
+/**
+ * @file frozen_tree.hpp
+ * @brief Read-only ValueTree packed into one contiguous buffer.
+ * Based on ValueTree.
+ */
+
+#ifndef __C2P_FROZEN_TREE_HPP__
+#define __C2P_FROZEN_TREE_HPP__
+
+#include <c2p/common.hpp>
+#include <c2p/value_tree.hpp>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace c2p {
+
+class FrozenNode;
+class FrozenTree;
+
+/// Layout of the buffer of `FrozenTree`. It has no pointers, only offsets
+/// from the start of the buffer, so the buffer can be copied or mapped as
+/// it is:
+/// - `Header`.
+/// - `Node`s in depth-first order. The root is node 0.
+/// - Tables of arrays (node indices) and of objects (`Entry`s sorted by key).
+/// - String heap of keys and STRING values. Equal strings are stored once.
+namespace frozen {
+
+struct Header {
+    uint64_t size;          ///< Bytes of the whole buffer.
+    uint32_t nodeCount;     ///< Number of nodes, 0 for an empty tree.
+    uint32_t reserved;
+    uint64_t tablesOffset;  ///< Offset of the tables.
+    uint64_t stringsOffset; ///< Offset of the string heap.
+};
+
+struct Node {
+    uint8_t state;    ///< `ValueTree::State`.
+    uint8_t typeTag;  ///< `TypeTag` of a value.
+    uint16_t reserved;
+    uint32_t size;    ///< Elements of an array or object, bytes of a string.
+    /// BOOL, INTEGER and NUMBER: the value. STRING: offset in the string
+    /// heap. ARRAY and OBJECT: offset of the table in the tables.
+    uint64_t payload;
+};
+
+/// Element of an object table.
+struct Entry {
+    uint32_t keyOffset;  ///< Offset of the key in the string heap.
+    uint32_t keySize;
+    uint32_t node;
+    uint32_t reserved;
+};
+
+}  // namespace frozen
+
+/// Array of a `FrozenTree`. Iterates `FrozenNode`s.
+/// Returned by value, which converts to false if the node is NOT an array.
+class FrozenArray
+{
+  public:
+
+    /// Not an array.
+    FrozenArray() = default;
+
+    /// Return false if the node is NOT an array.
+    explicit operator bool() const { return _base != nullptr; }
+
+    class const_iterator
+    {
+      public:
+
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = FrozenNode;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = FrozenNode;
+
+        const_iterator(const char* base, const char* table, size_t index)
+            : _base(base), _table(table), _index(index) {}
+
+        FrozenNode operator*() const;
+
+        const_iterator& operator++() {
+            ++_index;
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return _index == other._index;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return _index != other._index;
+        }
+
+      private:
+
+        const char* _base;
+        const char* _table;
+        size_t _index;
+    };
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    /// Get the element at `index`, which must be less than `size()`.
+    FrozenNode operator[](size_t index) const;
+
+    const_iterator begin() const { return const_iterator(_base, _table, 0); }
+    const_iterator end() const {
+        return const_iterator(_base, _table, _size);
+    }
+
+  private:
+
+    friend class FrozenNode;
+
+    FrozenArray(const char* base, const char* table, size_t size)
+        : _base(base), _table(table), _size(size) {}
+
+    static FrozenNode _at(const char* base, const char* table, size_t index);
+
+    const char* _base = nullptr;
+    const char* _table = nullptr;
+    size_t _size = 0;
+};
+
+/// Object of a `FrozenTree`. Iterates pairs of keys and `FrozenNode`s in
+/// the order of keys, which are sorted by bytes.
+/// Returned by value, which converts to false if the node is NOT an object.
+class FrozenObject
+{
+  public:
+
+    /// Not an object.
+    FrozenObject() = default;
+
+    /// Return false if the node is NOT an object.
+    explicit operator bool() const { return _base != nullptr; }
+
+    using value_type = std::pair<std::string_view, FrozenNode>;
+
+    class const_iterator
+    {
+      public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FrozenObject::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        const_iterator(const char* base, const char* table, size_t index)
+            : _base(base), _table(table), _index(index) {}
+
+        value_type operator*() const;
+
+        const_iterator& operator++() {
+            ++_index;
+            return *this;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return _index == other._index;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return _index != other._index;
+        }
+
+      private:
+
+        const char* _base;
+        const char* _table;
+        size_t _index;
+    };
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+
+    /// Find the node of `key` by binary search.
+    /// If NOT found, return an empty node.
+    FrozenNode find(std::string_view key) const;
+
+    const_iterator begin() const { return const_iterator(_base, _table, 0); }
+    const_iterator end() const {
+        return const_iterator(_base, _table, _size);
+    }
+
+  private:
+
+    friend class FrozenNode;
+
+    FrozenObject(const char* base, const char* table, size_t size)
+        : _base(base), _table(table), _size(size) {}
+
+    static frozen::Entry _entry(const char* table, size_t index) {
+        frozen::Entry entry;
+        std::memcpy(
+            &entry, table + index * sizeof(frozen::Entry), sizeof(entry)
+        );
+        return entry;
+    }
+
+    static value_type _at(const char* base, const char* table, size_t index);
+
+    const char* _base = nullptr;
+    const char* _table = nullptr;
+    size_t _size = 0;
+};
+
+/// Node of a `FrozenTree`, with the same read API as a const `ValueTree`.
+/// Lookups return an empty node instead of nullptr if NOT found, which
+/// converts to false. Refers to the buffer of its FrozenTree, which must
+/// outlive it.
+class FrozenNode
+{
+  public:
+
+    /// Empty node.
+    FrozenNode() = default;
+
+    /// Get the state of the node.
+    ValueTree::State state() const {
+        if (!_node) return ValueTree::State::EMPTY;
+        return static_cast<ValueTree::State>(_node->state);
+    }
+
+    /// Return false if is an empty node.
+    explicit operator bool() const { return !isEmpty(); }
+
+    /// If the node state is State::EMPTY.
+    bool isEmpty() const { return state() == ValueTree::State::EMPTY; }
+
+    /// If the node state is State::VALUE.
+    bool isValue() const { return state() == ValueTree::State::VALUE; }
+
+    /// If the node state is State::ARRAY.
+    bool isArray() const { return state() == ValueTree::State::ARRAY; }
+
+    /// If the node state is State::OBJECT.
+    bool isObject() const { return state() == ValueTree::State::OBJECT; }
+
+  public:
+
+    /// Try to get sub node at specified key.
+    /// If state of current node is NOT State::OBJECT, or key NOT found,
+    /// return an empty node.
+    FrozenNode subTree(std::string_view key) const;
+
+    /// Try to get sub node at specified index.
+    /// If state of current node is NOT State::ARRAY, or index NOT found,
+    /// return an empty node.
+    FrozenNode subTree(size_t index) const;
+
+    /// Try to get sub node at specified path.
+    /// If path NOT found, return an empty node.
+    template <typename... Args>
+    FrozenNode subTree(std::string_view key, Args&&... args) const {
+        return subTree(key).subTree(std::forward<Args>(args)...);
+    }
+
+    /// Try to get sub node at specified path.
+    /// If path NOT found, return an empty node.
+    template <typename... Args>
+    FrozenNode subTree(size_t index, Args&&... args) const {
+        return subTree(index).subTree(std::forward<Args>(args)...);
+    }
+
+    /// Try to get sub node at specified path, see `Path`. Frozen nodes never
+    /// change, so the path is NOT cached.
+    FrozenNode subTree(const Path& path) const {
+        FrozenNode node = *this;
+        for (const auto& step: path.steps()) {
+            if (const auto key = std::get_if<std::string>(&step)) {
+                node = node.subTree(std::string_view(*key));
+            } else {
+                node = node.subTree(std::get<size_t>(step));
+            }
+            if (!node) break;
+        }
+        return node;
+    }
+
+    /// Try to get the value. STRING values refer to the buffer of the
+    /// FrozenTree without copying, see `ValueNode::view`.
+    /// If state of current node is NOT State::VALUE, return std::nullopt.
+    std::optional<ValueNode> getValue() const;
+
+    /// Try to get the value at specified path.
+    /// If path NOT found, or it is NOT a value, return std::nullopt.
+    template <typename... Args>
+    std::optional<ValueNode> getValue(Args&&... args) const {
+        return subTree(std::forward<Args>(args)...).getValue();
+    }
+
+    /// Try to get the array.
+    /// If state of current node is NOT State::ARRAY, return a null array.
+    FrozenArray getArray() const;
+
+    /// Try to get the array at specified path.
+    /// If path NOT found, or it is NOT an array, return a null array.
+    template <typename... Args>
+    FrozenArray getArray(Args&&... args) const {
+        return subTree(std::forward<Args>(args)...).getArray();
+    }
+
+    /// Try to get the object.
+    /// If state of current node is NOT State::OBJECT, return a null object.
+    FrozenObject getObject() const;
+
+    /// Try to get the object at specified path.
+    /// If path NOT found, or it is NOT an object, return a null object.
+    template <typename... Args>
+    FrozenObject getObject(Args&&... args) const {
+        return subTree(std::forward<Args>(args)...).getObject();
+    }
+
+    /// Try to get stored value.
+    /// If state of current node is NOT State::VALUE, return std::nullopt.
+    /// If value of current node is NOT the same as template TypeTag,
+    /// return std::nullopt.
+    template <TypeTag typeTag>
+    auto value() const -> std::optional<typename TypeOfTag<typeTag>::type> {
+        const auto node = getValue();
+        if (!node) return std::nullopt;
+        return node->template value<typeTag>();
+    }
+
+    /// Try to get stored value at specified path.
+    /// If path NOT found, return std::nullopt.
+    /// If state of found node is NOT State::VALUE, return std::nullopt.
+    /// If value of found node is NOT the same as template TypeTag,
+    /// return std::nullopt.
+    template <TypeTag typeTag, typename... Args>
+    auto value(Args&&... args) const
+        -> std::optional<typename TypeOfTag<typeTag>::type> {
+        return subTree(std::forward<Args>(args)...).template value<typeTag>();
+    }
+
+    /// Copy the node into a mutable ValueTree.
+    ValueTree thaw() const;
+
+  private:
+
+    friend class FrozenTree;
+    friend class FrozenArray;
+    friend class FrozenObject;
+
+    FrozenNode(const char* base, uint32_t index)
+        : _base(base), _node(_nodes(base) + index) {}
+
+    static const frozen::Header* _header(const char* base) {
+        return reinterpret_cast<const frozen::Header*>(base);
+    }
+
+    static const frozen::Node* _nodes(const char* base) {
+        return reinterpret_cast<const frozen::Node*>(
+            base + sizeof(frozen::Header)
+        );
+    }
+
+    const char* _table() const {
+        return _base + _header(_base)->tablesOffset + _node->payload;
+    }
+
+    static std::string_view _string(
+        const char* base,
+        uint64_t offset,
+        size_t size
+    ) {
+        return std::string_view(
+            base + _header(base)->stringsOffset + offset, size
+        );
+    }
+
+    /// Buffer of the FrozenTree.
+    const char* _base = nullptr;
+
+    /// This node in the buffer, nullptr if empty.
+    const frozen::Node* _node = nullptr;
+};
+
+/// Read-only copy of a `ValueTree`, packed into one contiguous buffer
+/// without pointers, see `frozen::Header`. Reading it allocates nothing
+/// and touches far fewer cache lines than the ValueTree it was made from.
+///
+/// Has the same read API as its root `FrozenNode`. Objects are iterated in
+/// the order of keys, and empty subtrees of objects are dropped.
+///
+/// The buffer is immutable and shared by copies of the tree.
+class FrozenTree
+{
+  public:
+
+    /// Empty tree.
+    FrozenTree();
+
+    /// Freeze `tree`. Throw std::length_error if the strings of the tree
+    /// exceed 4 GiB.
+    explicit FrozenTree(const ValueTree& tree);
+
+    /// Use `size` bytes at `data` as the buffer without copying, e.g. memory
+    /// mapped from a file. `data` must be aligned to 8 bytes and is kept alive
+    /// by the tree and its copies.
+    ///
+    /// Only the header is checked, the rest of the buffer must be trusted,
+    /// e.g. by a checksum. Return std::nullopt if the header is invalid.
+    static std::optional<FrozenTree> constructFrom(
+        std::shared_ptr<const char> data,
+        size_t size,
+        const Logger& logger = Logger()
+    );
+
+    /// Get the root node.
+    FrozenNode root() const {
+        if (_header()->nodeCount == 0) return FrozenNode();
+        return FrozenNode(data(), 0);
+    }
+
+    /// The buffer, `size()` bytes aligned to 8 bytes.
+    const char* data() const { return _data.get(); }
+
+    /// Bytes of the buffer.
+    size_t size() const { return _header()->size; }
+
+    ValueTree::State state() const { return root().state(); }
+    explicit operator bool() const { return bool(root()); }
+    bool isEmpty() const { return root().isEmpty(); }
+    bool isValue() const { return root().isValue(); }
+    bool isArray() const { return root().isArray(); }
+    bool isObject() const { return root().isObject(); }
+
+    /// See `FrozenNode::subTree`.
+    template <typename... Args>
+    FrozenNode subTree(Args&&... args) const {
+        return root().subTree(std::forward<Args>(args)...);
+    }
+
+    /// See `FrozenNode::getValue`.
+    template <typename... Args>
+    std::optional<ValueNode> getValue(Args&&... args) const {
+        return root().getValue(std::forward<Args>(args)...);
+    }
+
+    /// See `FrozenNode::getArray`.
+    template <typename... Args>
+    FrozenArray getArray(Args&&... args) const {
+        return root().getArray(std::forward<Args>(args)...);
+    }
+
+    /// See `FrozenNode::getObject`.
+    template <typename... Args>
+    FrozenObject getObject(Args&&... args) const {
+        return root().getObject(std::forward<Args>(args)...);
+    }
+
+    /// See `FrozenNode::value`.
+    template <TypeTag typeTag, typename... Args>
+    auto value(Args&&... args) const
+        -> std::optional<typename TypeOfTag<typeTag>::type> {
+        return root().template value<typeTag>(std::forward<Args>(args)...);
+    }
+
+    /// Copy the tree into a mutable ValueTree.
+    ValueTree thaw() const { return root().thaw(); }
+
+  private:
+
+    explicit FrozenTree(std::shared_ptr<const char> data)
+        : _data(std::move(data)) {}
+
+    /// Allocate a zeroed buffer of `size` bytes, in 64-bit words so that it
+    /// is aligned for `frozen::Node`.
+    static std::shared_ptr<char> _allocate(size_t size);
+
+    const frozen::Header* _header() const {
+        return reinterpret_cast<const frozen::Header*>(_data.get());
+    }
+
+    std::shared_ptr<const char> _data;
+};
+
+/// Freeze `tree`, see `FrozenTree`.
+inline FrozenTree freeze(const ValueTree& tree) { return FrozenTree(tree); }
+
+inline FrozenNode FrozenNode::subTree(std::string_view key) const {
+    if (!isObject()) return FrozenNode();
+    return FrozenObject(_base, _table(), _node->size).find(key);
+}
+
+inline FrozenNode FrozenNode::subTree(size_t index) const {
+    if (!isArray() || index >= _node->size) return FrozenNode();
+    return FrozenArray(_base, _table(), _node->size)[index];
+}
+
+inline FrozenArray FrozenNode::getArray() const {
+    if (!isArray()) return FrozenArray();
+    return FrozenArray(_base, _table(), _node->size);
+}
+
+inline FrozenObject FrozenNode::getObject() const {
+    if (!isObject()) return FrozenObject();
+    return FrozenObject(_base, _table(), _node->size);
+}
+
+inline std::optional<ValueNode> FrozenNode::getValue() const {
+    if (!isValue()) return std::nullopt;
+    switch (static_cast<TypeTag>(_node->typeTag)) {
+        case TypeTag::BOOL: return ValueNode(_node->payload != 0);
+        case TypeTag::INTEGER: return ValueNode(int64_t(_node->payload));
+        case TypeTag::NUMBER: {
+            double number;
+            std::memcpy(&number, &_node->payload, sizeof(number));
+            return ValueNode(number);
+        }
+        case TypeTag::STRING:
+            return ValueNode::view(_string(_base, _node->payload, _node->size));
+        default: return ValueNode(NONE);
+    }
+}
+
+inline FrozenNode FrozenArray::_at(
+    const char* base,
+    const char* table,
+    size_t index
+) {
+    uint32_t node;
+    std::memcpy(&node, table + index * sizeof(uint32_t), sizeof(node));
+    return FrozenNode(base, node);
+}
+
+inline FrozenNode FrozenArray::const_iterator::operator*() const {
+    return _at(_base, _table, _index);
+}
+
+inline FrozenNode FrozenArray::operator[](size_t index) const {
+    return _at(_base, _table, index);
+}
+
+inline auto FrozenObject::_at(const char* base, const char* table, size_t index)
+    -> value_type {
+    const auto entry = _entry(table, index);
+    return { FrozenNode::_string(base, entry.keyOffset, entry.keySize),
+             FrozenNode(base, entry.node) };
+}
+
+inline auto FrozenObject::const_iterator::operator*() const -> value_type {
+    return _at(_base, _table, _index);
+}
+
+inline FrozenNode FrozenObject::find(std::string_view key) const {
+    size_t low = 0;
+    size_t high = _size;
+    while (low < high) {
+        const size_t mid = low + (high - low) / 2;
+        const auto entry = _entry(_table, mid);
+        const auto midKey =
+            FrozenNode::_string(_base, entry.keyOffset, entry.keySize);
+        const int cmp = midKey.compare(key);
+        if (cmp == 0) return FrozenNode(_base, entry.node);
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    return FrozenNode();
+}
+
+}  // namespace c2p
+
+#endif  // __C2P_FROZEN_TREE_HPP__
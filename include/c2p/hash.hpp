@@ -0,0 +1,89 @@
+/**
+ * @file hash.hpp
+ * @brief Content hashes of ValueTrees, e.g. for cache keys and for checks
+ * whether a config has changed. Based on ValueTree.
+ */
+
+#ifndef __C2P_HASH_HPP__
+#define __C2P_HASH_HPP__
+
+#include <c2p/value_tree.hpp>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+namespace c2p {
+
+/// Get the content hash of `tree`, without caching, see `SubtreeHashes`.
+///
+/// The hash of a tree is computed from the hashes of its subtrees (a Merkle
+/// tree). Equal trees have equal hashes: keys of objects are hashed
+/// regardless of their order, empty subtrees of arrays and objects count as
+/// absent, and -0.0 equals 0.0. INTEGER 1 and NUMBER 1.0 are different, the
+/// same as `ValueNode::operator==`. Trees with equal hashes have the same
+/// `json::dumpCanonical`, unless hashes collide.
+///
+/// Hashes are stable across runs and builds, so they can be stored or
+/// compared between processes on machines of the same byte order.
+uint64_t hash(const ValueTree& tree);
+
+/// Hashes of subtrees, cached with their generations, see
+/// `ValueTree::generation()`. A subtree is only hashed again after it has
+/// been modified, so checking a whole tree again for changes only visits the
+/// modified paths.
+///
+/// Modifications through references kept from earlier calls, e.g. a
+/// `ValueTree&` returned by `operator[]` and written later, do NOT change
+/// any generation, so stale hashes are returned for the modified subtree and
+/// all trees above it. Call `touch()` on the modified subtree and on every
+/// tree on the path to it after such modifications, or reach the subtree
+/// again through non-const member functions from the root.
+///
+/// Keep one cache for the trees which are hashed again and again, e.g. the
+/// current config of a program which is compared with every reloaded one.
+/// Subtrees are cached by their addresses, and hashes which are NOT used
+/// again are dropped after more new ones are cached, so the cache does NOT
+/// grow with the hashes of destroyed trees.
+class SubtreeHashes
+{
+  public:
+
+    /// Get the hash of `tree`, same as `c2p::hash`.
+    uint64_t hash(const ValueTree& tree);
+
+    /// Check whether `lhs` and `rhs` are equal by their hashes. Hashes are
+    /// 64 bits, so different trees are very unlikely to be taken as equal.
+    bool equal(const ValueTree& lhs, const ValueTree& rhs) {
+        return hash(lhs) == hash(rhs);
+    }
+
+    /// Drop all cached hashes at once, e.g. to free their memory after the
+    /// trees are destroyed. Trees hashed later are hashed again.
+    void clear() {
+        _hashes.clear();
+        _sweptSize = 0;
+    }
+
+  private:
+
+    struct _Entry {
+        uint64_t generation;
+        uint64_t hash;
+        /// `_epoch` when the hash was last used.
+        uint64_t epoch;
+    };
+
+    /// Hash of each subtree, with its generation.
+    std::unordered_map<const ValueTree*, _Entry> _hashes;
+
+    /// Hashes NOT used in the current epoch are dropped by the next sweep,
+    /// which starts a new epoch.
+    uint64_t _epoch = 0;
+
+    /// Number of hashes kept by the last sweep.
+    size_t _sweptSize = 0;
+};
+
+}  // namespace c2p
+
+#endif  // __C2P_HASH_HPP__
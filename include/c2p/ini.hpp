@@ -13,6 +13,20 @@
 namespace c2p {
 namespace ini {
 
+/// Options of INI parsing.
+struct ParseOptions {
+
+    /// Allocate all sections of the tree from this resource, e.g. a
+    /// `std::pmr::monotonic_buffer_resource`. The resource must outlive the
+    /// tree. If nullptr, use `std::pmr::get_default_resource()`.
+    MemoryResource* resource = nullptr;
+
+    /// Store values without escapes as views into the input INI string
+    /// instead of copies, see `ValueNode::view`. The input INI string must
+    /// outlive the tree and all copies of it.
+    bool viewStrings = false;
+};
+
 /// Parse INI string into ValueTree.
 ///
 /// If the input INI string is invalid, return an empty ValueTree.
@@ -23,6 +37,82 @@ namespace ini {
 /// - Allow empty value string even without quotes.
 ValueTree parse(const std::string& ini, const Logger& logger = Logger());
 
+/// Parse INI string into ValueTree, allocating all sections of the tree from
+/// `resource`, e.g. a `std::pmr::monotonic_buffer_resource`.
+///
+/// The resource must outlive the returned tree. Copies of the tree allocate
+/// from the default resource again.
+ValueTree parse(
+    const std::string& ini,
+    MemoryResource* resource,
+    const Logger& logger = Logger()
+);
+
+/// Parse INI string into ValueTree with options. See `ParseOptions`.
+ValueTree parse(
+    const std::string& ini,
+    const ParseOptions& options,
+    const Logger& logger = Logger()
+);
+
+/// Parse INI string into `tree`, reusing its sections, entries and strings
+/// where they are the same as in the input, see `json::parseInto`.
+///
+/// Return false and clear `tree` if the input INI string is invalid.
+bool parseInto(
+    ValueTree& tree,
+    const std::string& ini,
+    const ParseOptions& options = ParseOptions(),
+    const Logger& logger = Logger()
+);
+
+/// Parse the INI file at `path` into ValueTree with options, see `parse`.
+///
+/// The file is memory mapped and parsed in place, without copying it into a
+/// string, or read into memory if it cannot be mapped, e.g. a pipe.
+/// `options.viewStrings` is ignored, since the mapping does NOT outlive the
+/// call. Errors are prefixed with the path, e.g. "a.ini: line:3:7: ...".
+ValueTree parseFile(
+    const std::string& path,
+    const ParseOptions& options = ParseOptions(),
+    const Logger& logger = Logger()
+);
+
+/// Receiver of the events of `parse(ini, handler)`, for consumers which
+/// stream through a document instead of building a ValueTree.
+///
+/// Events come in document order. Each event returns whether to continue
+/// parsing. By default all events are ignored.
+class Handler
+{
+  public:
+
+    virtual ~Handler() = default;
+
+    /// Header of a section, whose entries follow. Entries before the first
+    /// section are global.
+    virtual bool section(std::string_view) { return true; }
+
+    /// An entry of the current section. Key and value view the input INI
+    /// string, or buffers of the parser if they have escapes, and are only
+    /// valid during the call.
+    virtual bool entry(std::string_view, std::string_view) { return true; }
+};
+
+/// Parse INI string into the events of `handler`, without building a tree.
+/// `parse` into ValueTree is built on the same events.
+///
+/// Allocate nothing for keys and values without escapes. The only
+/// allocation is the table of lines, for line numbers in errors.
+///
+/// Return false if the input INI string is invalid, in which case the events
+/// of its valid prefix are already sent, or if `handler` stopped.
+bool parse(
+    const std::string& ini,
+    Handler& handler,
+    const Logger& logger = Logger()
+);
+
 /// Serialize ValueTree into INI string.
 ///
 /// If ValueTree is empty, return an empty string.
@@ -33,6 +123,17 @@ ValueTree parse(const std::string& ini, const Logger& logger = Logger());
 /// be returned.
 std::string dump(const ValueTree& tree);
 
+/// Serialize ValueTree as INI into the file at `path`, see `dump`.
+///
+/// The file is replaced atomically, so that readers see either the old or
+/// the new contents. Return false, leaving the file as it is, if the tree
+/// can NOT be converted to INI or the file cannot be written.
+bool dumpFile(
+    const ValueTree& tree,
+    const std::string& path,
+    const Logger& logger = Logger()
+);
+
 }  // namespace ini
 }  // namespace c2p
 
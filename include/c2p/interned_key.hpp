@@ -0,0 +1,130 @@
+/**
+ * @file interned_key.hpp
+ * @brief Object keys interned in a global string pool.
+ */
+
+#ifndef __C2P_INTERNED_KEY_HPP__
+#define __C2P_INTERNED_KEY_HPP__
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace c2p {
+
+/// Handle of a string interned in a global pool. Equal strings share one
+/// pooled copy, so a key costs the size of a pointer no matter how often it
+/// repeats, and two keys are compared by their pointers.
+///
+/// Used as the key type of `ObjectNode` when `C2P_INTERNED_KEYS` (CMake
+/// option of the same name) is defined. Converts implicitly from and to
+/// std::string and std::string_view, so it can mostly be used like the
+/// std::string key it replaces.
+///
+/// Pooled strings are never freed. Interning is thread-safe, each thread
+/// caches recently interned keys to avoid locking.
+class InternedKey
+{
+  public:
+
+    /// Empty string.
+    InternedKey(): InternedKey(std::string_view()) {}
+
+    InternedKey(std::string_view str): _entry(_intern(str)) {}
+    InternedKey(const std::string& str): InternedKey(std::string_view(str)) {}
+    InternedKey(const char* str): InternedKey(std::string_view(str)) {}
+
+    const std::string& str() const { return _entry->str; }
+    const char* c_str() const { return _entry->str.c_str(); }
+    const char* data() const { return _entry->str.data(); }
+    size_t size() const { return _entry->str.size(); }
+    bool empty() const { return _entry->str.empty(); }
+
+    /// Hash of the string, the same as `std::hash<std::string_view>`.
+    size_t hash() const { return _entry->hash; }
+
+    operator const std::string&() const { return _entry->str; }
+    operator std::string_view() const { return _entry->str; }
+
+    friend bool operator==(const InternedKey& lhs, const InternedKey& rhs) {
+        return lhs._entry == rhs._entry;
+    }
+    friend bool operator!=(const InternedKey& lhs, const InternedKey& rhs) {
+        return lhs._entry != rhs._entry;
+    }
+    friend bool operator<(const InternedKey& lhs, const InternedKey& rhs) {
+        return lhs._entry != rhs._entry && lhs.str() < rhs.str();
+    }
+
+  private:
+
+    /// One pooled string.
+    struct Entry {
+        std::string str;
+        size_t hash;
+    };
+
+    /// Get the pooled entry of `str`, adding it if NOT found.
+    static const Entry* _intern(std::string_view str);
+
+    const Entry* _entry;
+};
+
+/// A string type other than InternedKey, compared with InternedKey by
+/// contents. Both sides are template parameters, so that neither side is
+/// converted, and comparisons of other strings are NOT affected.
+template <typename Key, typename T>
+using _IfKeyAndString = std::enable_if_t<
+    std::is_same_v<Key, InternedKey> && !std::is_same_v<T, InternedKey>
+        && std::is_convertible_v<const T&, std::string_view>,
+    bool>;
+
+template <typename K, typename T>
+auto operator==(const K& lhs, const T& rhs) -> _IfKeyAndString<K, T> {
+    return std::string_view(lhs) == std::string_view(rhs);
+}
+
+template <typename T, typename K>
+auto operator==(const T& lhs, const K& rhs) -> _IfKeyAndString<K, T> {
+    return std::string_view(lhs) == std::string_view(rhs);
+}
+
+template <typename K, typename T>
+auto operator!=(const K& lhs, const T& rhs) -> _IfKeyAndString<K, T> {
+    return std::string_view(lhs) != std::string_view(rhs);
+}
+
+template <typename T, typename K>
+auto operator!=(const T& lhs, const K& rhs) -> _IfKeyAndString<K, T> {
+    return std::string_view(lhs) != std::string_view(rhs);
+}
+
+template <typename K, typename T>
+auto operator<(const K& lhs, const T& rhs) -> _IfKeyAndString<K, T> {
+    return std::string_view(lhs) < std::string_view(rhs);
+}
+
+template <typename T, typename K>
+auto operator<(const T& lhs, const K& rhs) -> _IfKeyAndString<K, T> {
+    return std::string_view(lhs) < std::string_view(rhs);
+}
+
+inline std::ostream& operator<<(std::ostream& os, const InternedKey& key) {
+    return os << key.str();
+}
+
+}  // namespace c2p
+
+namespace std {
+
+template <>
+struct hash<c2p::InternedKey> {
+    size_t operator()(const c2p::InternedKey& key) const { return key.hash(); }
+};
+
+}  // namespace std
+
+#endif  // __C2P_INTERNED_KEY_HPP__
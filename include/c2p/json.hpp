@@ -9,10 +9,41 @@
 
 #include <c2p/common.hpp>
 #include <c2p/value_tree.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace c2p {
 namespace json {
 
+/// Options of JSON parsing.
+struct ParseOptions {
+
+    /// Allocate all arrays and objects of the tree from this resource, e.g. a
+    /// `std::pmr::monotonic_buffer_resource`. The resource must outlive the
+    /// tree. If nullptr, use `std::pmr::get_default_resource()`.
+    MemoryResource* resource = nullptr;
+
+    /// Store string values without escapes as views into the input JSON
+    /// string instead of copies, see `ValueNode::view`. The input JSON string
+    /// must outlive the tree and all copies of it.
+    bool viewStrings = false;
+
+    /// Maximum nesting depth of arrays and objects. Deeper input is invalid.
+    /// Parsing does NOT recurse, so this only bounds the depth of the trees
+    /// passed to recursive functions like `merge`.
+    size_t maxDepth = 1024;
+
+    /// Threads which parse in parallel, including the calling one, see
+    /// `parse` and `parseLines`. 0 means `std::thread::hardware_concurrency()`.
+    /// With more than one, `resource` must be thread-safe, e.g. a
+    /// `std::pmr::synchronized_pool_resource`.
+    size_t threads = 1;
+};
+
 /// Parse JSON string into ValueTree.
 ///
 /// If the input JSON string is invalid, return an empty ValueTree.
@@ -23,12 +54,327 @@ namespace json {
 /// - Allow single-line comment starts with "//".
 ValueTree parse(const std::string& json, const Logger& logger = Logger());
 
+/// Parse JSON string into ValueTree, allocating all arrays and objects of the
+/// tree from `resource`, e.g. a `std::pmr::monotonic_buffer_resource`.
+///
+/// The resource must outlive the returned tree. Copies of the tree allocate
+/// from the default resource again.
+ValueTree parse(
+    const std::string& json,
+    MemoryResource* resource,
+    const Logger& logger = Logger()
+);
+
+/// Parse JSON string into ValueTree with options. See `ParseOptions`.
+///
+/// With `options.threads`, a large root array or object is split between
+/// members into ranges of at least 256 KB, which are parsed in parallel and
+/// moved into the tree. The tree and the errors are the same as with one
+/// thread: if any range fails, the whole input is parsed again by the calling
+/// thread, which reports the errors.
+ValueTree parse(
+    const std::string& json,
+    const ParseOptions& options,
+    const Logger& logger = Logger()
+);
+
+/// Parse JSON string into `tree`, reusing its storage, e.g. to reload a
+/// config which rarely changes into the tree of the last load.
+///
+/// The result is the same as of `parse`, but arrays, members of objects and
+/// strings which are at the same place in the old tree are overwritten in
+/// place, so a nearly identical input allocates little. Only arrays and
+/// objects allocating from `options.resource` are reused. `options.threads`
+/// is ignored.
+///
+/// Return false and clear `tree` if the input JSON string is invalid.
+bool parseInto(
+    ValueTree& tree,
+    const std::string& json,
+    const ParseOptions& options = ParseOptions(),
+    const Logger& logger = Logger()
+);
+
+/// Parse the JSON file at `path` into ValueTree with options, see `parse`.
+///
+/// The file is memory mapped and parsed in place, without copying it into a
+/// string, or read into memory if it cannot be mapped, e.g. a pipe.
+/// `options.viewStrings` is ignored, since the mapping does NOT outlive the
+/// call. Errors are prefixed with the path, e.g. "a.json: line:3:7: ...".
+ValueTree parseFile(
+    const std::string& path,
+    const ParseOptions& options = ParseOptions(),
+    const Logger& logger = Logger()
+);
+
+/// Parse newline-delimited JSON (JSON Lines), one value per line, e.g. a file
+/// of records. The input is split at line breaks into `options.threads`
+/// chunks of about the same size, which are parsed in parallel.
+///
+/// Return the trees of the lines in input order. Lines with nothing but
+/// whitespaces and comments are skipped. An invalid line gives an empty
+/// ValueTree, and its errors are logged at their line in the whole input.
+/// All errors are logged from the calling thread, in input order.
+std::vector<ValueTree> parseLines(
+    const std::string& lines,
+    const ParseOptions& options = ParseOptions(),
+    const Logger& logger = Logger()
+);
+
+/// Receiver of the events of `parse(json, handler)`, for consumers which
+/// stream through a document instead of building a ValueTree.
+///
+/// Events come in document order, e.g. `{"a": [1]}` gives `startObject()`,
+/// `key("a")`, `startArray()`, `value(1)`, `endArray()`, `endObject()`.
+/// Each event returns whether to continue parsing. By default all events are
+/// ignored.
+class Handler
+{
+  public:
+
+    virtual ~Handler() = default;
+
+    virtual bool startObject() { return true; }
+
+    /// Key of the next member of the innermost object. It views the input
+    /// JSON string, or a buffer of the parser if it has escapes, and is only
+    /// valid during the call.
+    virtual bool key(std::string_view) { return true; }
+
+    virtual bool endObject() { return true; }
+
+    virtual bool startArray() { return true; }
+
+    virtual bool endArray() { return true; }
+
+    /// A string, number, bool or null. Strings are views like keys, see
+    /// `ValueNode::view`, and must be copied to outlive the call.
+    virtual bool value(const ValueNode&) { return true; }
+};
+
+/// Parse JSON string into the events of `handler`, without building a tree.
+/// `parse` into ValueTree is built on the same events.
+///
+/// Allocate nothing for strings without escapes, as long as arrays and
+/// objects are nested less than 128 deep. `options.resource` and
+/// `options.viewStrings` are unused.
+///
+/// Return false if the input JSON string is invalid, in which case the
+/// events of its valid prefix are already sent, or if `handler` stopped.
+bool parse(
+    const std::string& json,
+    Handler& handler,
+    const Logger& logger = Logger()
+);
+
+/// Parse JSON string into the events of `handler` with options.
+bool parse(
+    const std::string& json,
+    Handler& handler,
+    const ParseOptions& options,
+    const Logger& logger = Logger()
+);
+
+/// Incremental JSON parser for input which arrives in chunks, e.g. from a pipe
+/// or a socket. Each chunk is parsed as soon as it is fed, so parsing overlaps
+/// with I/O and the whole input is never held: only a token which is split
+/// across chunks is kept until its end arrives.
+///
+/// Same grammar and trees as `parse`, except that `options.viewStrings` is
+/// ignored, since chunks do NOT outlive `feed`. Errors are reported at their
+/// line and column in the whole input, without the enclosing members.
+class PushParser
+{
+  public:
+
+    explicit PushParser(
+        const ParseOptions& options = ParseOptions(),
+        const Logger& logger = Logger()
+    );
+
+    /// The moved-from parser is ready for the next document, with the
+    /// default options and logger.
+    PushParser(PushParser&&) noexcept;
+    PushParser& operator=(PushParser&&) noexcept;
+    ~PushParser();
+
+    /// Parse the next chunk of input. A chunk may end anywhere, even in the
+    /// middle of a string, an escape or a number.
+    /// Return false if the input so far is invalid, after which chunks are
+    /// ignored until `finish`.
+    bool feed(const char* data, size_t size);
+
+    /// End the input and return the parsed tree, or an empty ValueTree if the
+    /// input is invalid or incomplete. The parser is then ready for the next
+    /// document.
+    ValueTree finish();
+
+  private:
+    struct _Parser;
+
+    /// Get the state, which is created again if moved from.
+    _Parser& _get();
+
+    std::unique_ptr<_Parser> _parser;
+};
+
 /// Serialize ValueTree into JSON string.
 ///
 /// If ValueTree is empty, return an empty string.
 /// If some subtrees are empty, they will not be serialized.
+/// NUMBERs always have a fraction or an exponent, so that they parse back as
+/// NUMBER and NOT as INTEGER.
 std::string dump(const ValueTree& tree, bool pretty = false, size_t indentStep = 2);
 
+/// Serialize ValueTree as JSON into `sink`, see `Sink`.
+///
+/// Same output as the string version, without building the whole string
+/// first. Call `sink.flush()` or destroy the sink to complete the output.
+void dump(
+    const ValueTree& tree,
+    Sink& sink,
+    bool pretty = false,
+    size_t indentStep = 2
+);
+
+/// Serialize ValueTree as JSON into the file at `path`, see `dump`.
+///
+/// The file is replaced atomically, so that readers see either the old or
+/// the new contents. Return false if it cannot be written.
+bool dumpFile(
+    const ValueTree& tree,
+    const std::string& path,
+    bool pretty = false,
+    size_t indentStep = 2,
+    const Logger& logger = Logger()
+);
+
+/// Serialize ValueTree into canonical JSON, e.g. as a cache key or for a
+/// signature which other programs can compute as well:
+/// - No whitespace, and empty subtrees are NOT serialized.
+/// - Keys of objects are sorted by their bytes, whatever the object type.
+/// - NUMBERs always have a fraction or an exponent, so that they parse back
+///   as NUMBER and NOT as INTEGER, and -0.0 is written as 0.0.
+///
+/// Trees which are equal for `c2p::hash` have the same canonical JSON.
+std::string dumpCanonical(const ValueTree& tree);
+
+/// Serialize ValueTree as canonical JSON into `sink`, see `Sink`.
+void dumpCanonical(const ValueTree& tree, Sink& sink);
+
+/// JSON document which is parsed on demand, for large documents of which
+/// only a few subtrees are used.
+///
+/// `index` only matches brackets and quotes, and records the byte range of
+/// every array and object. A subtree is parsed into a ValueTree the first
+/// time `subTree`, `getValue` or `value` reaches it, skipping its siblings by
+/// the recorded ranges. Untouched subtrees are never decoded, and errors in
+/// them are never reported.
+///
+/// Parsed subtrees are kept, and pointers to them stay valid as long as the
+/// document. Parsing a subtree which contains parsed ones parses them again.
+/// The document is NOT thread-safe, even for lookups.
+class LazyDocument
+{
+  public:
+
+    /// Index `json`. With `options.viewStrings`, strings are views into the
+    /// document, which must outlive them.
+    /// Return std::nullopt if brackets or quotes are unbalanced.
+    static std::optional<LazyDocument> index(
+        std::string json,
+        const ParseOptions& options = ParseOptions(),
+        const Logger& logger = Logger()
+    );
+
+    LazyDocument(LazyDocument&&) = default;
+    LazyDocument& operator=(LazyDocument&&) = default;
+
+    /// Parse the subtree at the path of keys, indices and `Path`s, same as
+    /// the arguments of `ValueTree::subTree`, if NOT parsed yet.
+    /// Without arguments, parse the whole document.
+    /// Return nullptr if NOT found, or if it is invalid JSON.
+    template <typename... Args>
+    const ValueTree* subTree(Args&&... args) {
+        _Cursor cursor = _root();
+        if (!(_step(cursor, std::forward<Args>(args)) && ...)) return nullptr;
+        return _parse(cursor);
+    }
+
+    /// Parse the value at the path, see `subTree`.
+    /// Return nullptr if NOT found, or if it is NOT a value.
+    template <typename... Args>
+    const ValueNode* getValue(Args&&... args) {
+        const auto tree = subTree(std::forward<Args>(args)...);
+        return tree ? tree->getValue() : nullptr;
+    }
+
+    /// Parse the value at the path, see `ValueTree::value`.
+    template <TypeTag typeTag, typename... Args>
+    auto value(Args&&... args)
+        -> std::optional<typename TypeOfTag<typeTag>::type> {
+        const auto tree = subTree(std::forward<Args>(args)...);
+        if (!tree) return std::nullopt;
+        return tree->template value<typeTag>();
+    }
+
+    /// Bytes of the document.
+    size_t size() const { return _json->size(); }
+
+    /// Bytes parsed into subtrees so far.
+    size_t parsedBytes() const { return _parsedBytes; }
+
+  private:
+
+    /// Byte range of an array or object, from its opening bracket to its
+    /// closing one.
+    struct _Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    /// Position of a lookup: a parsed subtree, or a value in the text.
+    struct _Cursor {
+        const ValueTree* tree;
+        uint32_t pos;
+    };
+
+    LazyDocument() = default;
+
+    _Cursor _root();
+
+    bool _step(_Cursor& cursor, std::string_view key);
+
+    bool _step(_Cursor& cursor, size_t index);
+
+    bool _step(_Cursor& cursor, const Path& path);
+
+    /// Use the parsed subtree at the position of the cursor if any.
+    void _reuse(_Cursor& cursor) const;
+
+    /// Skip the value at `pos` in the text.
+    const char* _skip(const char* pos) const;
+
+    const ValueTree* _parse(const _Cursor& cursor);
+
+    /// Kept at a fixed address, which parsed string views refer to.
+    std::unique_ptr<const std::string> _json;
+
+    /// Ranges of arrays and objects, in the order of their beginnings.
+    std::vector<_Range> _ranges;
+
+    /// Parsed subtrees by their positions.
+    std::unordered_map<uint32_t, ValueTree> _parsed;
+
+    size_t _parsedBytes = 0;
+
+    /// Position of the root value.
+    uint32_t _rootPos = 0;
+
+    ParseOptions _options;
+    Logger _logger;
+};
+
 }  // namespace json
 }  // namespace c2p
 
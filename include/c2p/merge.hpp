@@ -0,0 +1,153 @@
+/**
+ * @file merge.hpp
+ * @brief Merge layers of ValueTrees, e.g. defaults, config files and CLI.
+ * Based on ValueTree.
+ */
+
+#ifndef __C2P_MERGE_HPP__
+#define __C2P_MERGE_HPP__
+
+#include <c2p/value_tree.hpp>
+#include <initializer_list>
+#include <vector>
+
+namespace c2p {
+
+/// Options of merging layers, see `merge`.
+struct MergeOptions {
+
+    /// How an object is merged with objects of lower layers.
+    enum class Objects {
+        DEEP,     ///< Merge the subtrees of each key recursively.
+        REPLACE,  ///< Replace the objects of lower layers.
+    };
+
+    /// How an array is merged with arrays of lower layers.
+    enum class Arrays {
+        REPLACE,  ///< Replace the arrays of lower layers.
+        APPEND,   ///< Append to the elements of lower layers.
+    };
+
+    Objects objects = Objects::DEEP;
+    Arrays arrays = Arrays::REPLACE;
+};
+
+/// One layer of `merge`. Subtrees of a layer given as an rvalue are moved
+/// instead of copied, and the layer is left in a valid but unspecified
+/// state.
+class MergeLayer
+{
+  public:
+
+    MergeLayer(const ValueTree& tree): _tree(const_cast<ValueTree*>(&tree)) {}
+    MergeLayer(ValueTree&& tree): _tree(&tree), _movable(true) {}
+
+    ValueTree* tree() const { return _tree; }
+    bool movable() const { return _movable; }
+
+  private:
+
+    ValueTree* _tree;
+    bool _movable = false;
+};
+
+/// Merge layers of trees into one tree, in one traversal of all layers.
+/// Later layers take priority, e.g. `merge({ defaults, file, cli })`.
+///
+/// At each path, the tree of the highest layer which is NOT empty wins.
+/// Objects and arrays are merged with those of the layers right below, as
+/// specified by `options`. Anything else in lower layers is overridden.
+ValueTree merge(
+    std::initializer_list<MergeLayer> layers,
+    const MergeOptions& options = MergeOptions()
+);
+
+/// Same as the `std::initializer_list` version.
+ValueTree merge(
+    const std::vector<MergeLayer>& layers,
+    const MergeOptions& options = MergeOptions()
+);
+
+/// Read-only view of layers of trees as if they were merged by `merge`,
+/// without building the merged tree. Lookups go through the layers.
+///
+/// The layers must outlive the view and must NOT be modified while it is in
+/// use.
+class OverlayView
+{
+  public:
+
+    /// Later layers take priority, the same as `merge`.
+    explicit OverlayView(
+        std::vector<const ValueTree*> layers,
+        const MergeOptions& options = MergeOptions()
+    );
+
+    /// Get the state of the merged tree.
+    ValueTree::State state() const {
+        if (_layers.empty()) return ValueTree::State::EMPTY;
+        return _layers.back()->state();
+    }
+
+    /// If the merged tree is empty.
+    bool isEmpty() const { return _layers.empty(); }
+
+    /// Layers which make up the merged tree, lowest first. Empty and
+    /// overridden layers are excluded.
+    const std::vector<const ValueTree*>& layers() const { return _layers; }
+
+    /// Get the view of the merged subtree at specified key.
+    /// If NOT found, return an empty view.
+    OverlayView subView(std::string_view key) const;
+
+    /// Get the view of the merged subtree at specified index.
+    /// If NOT found, return an empty view.
+    OverlayView subView(size_t index) const;
+
+    /// Get the view of the merged subtree at specified path.
+    /// If NOT found, return an empty view.
+    template <typename Arg, typename Next, typename... Args>
+    OverlayView subView(Arg&& arg, Next&& next, Args&&... args) const {
+        return subView(std::forward<Arg>(arg))
+            .subView(std::forward<Next>(next), std::forward<Args>(args)...);
+    }
+
+    /// Try to get ValueNode pointer at specified path.
+    /// If path NOT found, or it is NOT a value, return nullptr.
+    template <typename... Args>
+    const ValueNode* getValue(Args&&... args) const {
+        if constexpr (sizeof...(args) == 0) {
+            if (_layers.empty()) return nullptr;
+            return _layers.back()->getValue();
+        } else {
+            return subView(std::forward<Args>(args)...).getValue();
+        }
+    }
+
+    /// Try to get stored value at specified path.
+    /// If path NOT found, return std::nullopt.
+    /// If value of found node is NOT the same as template TypeTag,
+    /// return std::nullopt.
+    template <TypeTag typeTag, typename... Args>
+    auto value(Args&&... args) const
+        -> std::optional<typename TypeOfTag<typeTag>::type> {
+        const auto node = getValue(std::forward<Args>(args)...);
+        if (!node) return std::nullopt;
+        return node->template value<typeTag>();
+    }
+
+    /// Build the merged tree, the same as `merge` of the layers.
+    ValueTree merged() const;
+
+  private:
+
+    /// Drop empty and overridden layers.
+    void _normalize();
+
+    std::vector<const ValueTree*> _layers;
+    MergeOptions _options;
+};
+
+}  // namespace c2p
+
+#endif  // __C2P_MERGE_HPP__
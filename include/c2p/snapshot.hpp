@@ -0,0 +1,89 @@
+/**
+ * @file snapshot.hpp
+ * @brief Binary snapshot files of FrozenTree, memory mapped at load.
+ * Based on FrozenTree.
+ */
+
+#ifndef __C2P_SNAPSHOT_HPP__
+#define __C2P_SNAPSHOT_HPP__
+
+#include <c2p/common.hpp>
+#include <c2p/frozen_tree.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace c2p {
+
+/// Snapshot file: a `snapshot::Header` followed by the buffer of a
+/// `FrozenTree` as it is. Loading maps the file and queries it in place,
+/// without parsing or allocating per node.
+///
+/// The encoding is native: snapshots are NOT portable between machines with
+/// different byte orders, which are detected at load.
+namespace snapshot {
+
+/// Version of the file format. Snapshots of other versions are stale.
+constexpr uint32_t VERSION = 1;
+
+/// First bytes of a snapshot file.
+constexpr char MAGIC[8] = { 'C', '2', 'P', 'S', 'N', 'A', 'P', '\0' };
+
+/// Written in native byte order, to detect snapshots of other machines.
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+    char magic[8];       ///< `MAGIC`.
+    uint32_t version;    ///< `VERSION`.
+    uint32_t byteOrder;  ///< `BYTE_ORDER_MARK`.
+    uint64_t sourceSize; ///< Bytes of the source file, 0 if none.
+    int64_t sourceTime;  ///< Last write time of the source file, 0 if none.
+    uint64_t checksum;   ///< XXH64 of the tree buffer.
+    uint64_t treeSize;   ///< Bytes of the tree buffer.
+};
+
+/// Write `tree` into a snapshot file at `path`, replacing it atomically.
+///
+/// If `sourcePath` is not empty, the size and last write time of that file
+/// are recorded, and `load` with the same source rejects the snapshot once
+/// the source is modified.
+///
+/// Return false if the file cannot be written.
+bool write(
+    const FrozenTree& tree,
+    const std::string& path,
+    const std::string& sourcePath = "",
+    const Logger& logger = Logger()
+);
+
+/// Map the snapshot file at `path` and verify its checksum.
+///
+/// If `sourcePath` is not empty, the snapshot must have been written from
+/// that file in its current state.
+///
+/// Return std::nullopt if the file is missing, corrupt, of another version or
+/// stale.
+std::optional<FrozenTree> load(
+    const std::string& path,
+    const std::string& sourcePath = "",
+    const Logger& logger = Logger()
+);
+
+/// Load the snapshot at `path` made from the JSON file at `jsonPath`.
+///
+/// If the snapshot cannot be loaded, e.g. it is missing or stale, parse the
+/// JSON file instead and write a new snapshot for the next load. Problems
+/// with the snapshot are reported as warnings, since they are recovered
+/// from.
+///
+/// Return an empty tree if the JSON file cannot be read or is invalid.
+FrozenTree loadOrParse(
+    const std::string& path,
+    const std::string& jsonPath,
+    const Logger& logger = Logger()
+);
+
+}  // namespace snapshot
+}  // namespace c2p
+
+#endif  // __C2P_SNAPSHOT_HPP__
@@ -6,10 +6,21 @@
 #ifndef __C2P_VALUE_TREE_HPP__
 #define __C2P_VALUE_TREE_HPP__
 
+#include <c2p/flat_map.hpp>
+#include <c2p/interned_key.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <limits>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -26,11 +37,12 @@ constexpr NoneValue NONE{ NoneValue::_Construct::_TOKEN };
 using BoolValue = bool;
 using NumberValue = double;
 using StringValue = std::string;
+using IntegerValue = int64_t;
 
 // clang-format off
 /// The number and order of template types must be consistent with enum `TypeTag`.
-using Value = std::variant< NoneValue, BoolValue, NumberValue, StringValue >;
-enum class TypeTag        { NONE,      BOOL,      NUMBER,      STRING,     };
+using Value = std::variant< NoneValue, BoolValue, NumberValue, StringValue, IntegerValue >;
+enum class TypeTag        { NONE,      BOOL,      NUMBER,      STRING,      INTEGER,     };
 // clang-format on
 
 /// Get the corresponding value type through the TypeTag enumeration value.
@@ -46,6 +58,7 @@ inline std::string to_string(TypeTag typeTag) {
         case TypeTag::BOOL: return "BOOL";
         case TypeTag::NUMBER: return "NUMBER";
         case TypeTag::STRING: return "STRING";
+        case TypeTag::INTEGER: return "INTEGER";
         default: return "UNKNOWN";
     }
 }
@@ -59,7 +72,10 @@ class ValueNode
   public:
 
     /// Get TypeTag of stored value.
-    TypeTag typeTag() const { return static_cast<TypeTag>(_value.index()); }
+    TypeTag typeTag() const {
+        if (_value.index() == _STRING_VIEW_INDEX) return TypeTag::STRING;
+        return static_cast<TypeTag>(_value.index());
+    }
 
     /// If the stored value is NONE.
     bool isNone() const { return typeTag() == TypeTag::NONE; }
@@ -67,21 +83,59 @@ class ValueNode
     /// If the stored value is BOOL.
     bool isBool() const { return typeTag() == TypeTag::BOOL; }
 
-    /// If the stored value is NUMBER.
-    bool isNumber() const { return typeTag() == TypeTag::NUMBER; }
+    /// If the stored value is NUMBER or INTEGER.
+    bool isNumber() const {
+        return typeTag() == TypeTag::NUMBER || typeTag() == TypeTag::INTEGER;
+    }
+
+    /// If the stored value is INTEGER.
+    bool isInteger() const { return typeTag() == TypeTag::INTEGER; }
 
     /// If the stored value is STRING.
     bool isString() const { return typeTag() == TypeTag::STRING; }
 
+    /// If the stored value is a STRING which refers to an external buffer.
+    /// See `ValueNode::view`.
+    bool isStringView() const { return _value.index() == _STRING_VIEW_INDEX; }
+
     /// Try to get stored value.
     /// If current value is NOT the same as template TypeTag,
     /// return std::nullopt.
+    /// An INTEGER value can also be got as NUMBER, which may lose precision.
     template <TypeTag tag>
     auto value() const -> std::optional<typename TypeOfTag<tag>::type> {
+        if constexpr (tag == TypeTag::NUMBER) {
+            if (isInteger()) {
+                return NumberValue(std::get<size_t(TypeTag::INTEGER)>(_value));
+            }
+        }
         if (typeTag() != tag) return std::nullopt;
-        else return std::get<size_t(tag)>(_value);
+        if constexpr (tag == TypeTag::STRING) {
+            if (isStringView()) {
+                return StringValue(std::get<_STRING_VIEW_INDEX>(_value));
+            }
+        }
+        return std::get<size_t(tag)>(_value);
+    }
+
+    /// Try to get stored STRING value without copying it.
+    /// If current value is NOT a STRING, return std::nullopt.
+    std::optional<std::string_view> stringView() const {
+        if (isStringView()) return std::get<_STRING_VIEW_INDEX>(_value);
+        if (!isString()) return std::nullopt;
+        return std::get<size_t(TypeTag::STRING)>(_value);
     }
 
+    /// Values are equal if they have the same TypeTag and the same value.
+    /// An INTEGER value is NOT equal to a NUMBER value.
+    bool operator==(const ValueNode& other) const {
+        if (typeTag() != other.typeTag()) return false;
+        if (isString()) return *stringView() == *other.stringView();
+        return _value == other._value;
+    }
+
+    bool operator!=(const ValueNode& other) const { return !(*this == other); }
+
   public:
 
     /// Default constructor. As NONE.
@@ -93,6 +147,9 @@ class ValueNode
     /// For bool.
     ValueNode(bool value): _value(value) {}
 
+    /// For double.
+    ValueNode(NumberValue value): _value(value) {}
+
     /// For const char*. Cast to std::string.
     ValueNode(const char* value): _value(std::string(value)) {}
 
@@ -105,12 +162,20 @@ class ValueNode
     /// For std::string&&.
     ValueNode(std::string&& value): _value(std::move(value)) {}
 
-    /// For integral types. Cast to double.
+    /// For integral types. Cast to int64_t, or to double if out of range.
     template <
         typename T,
         typename =
             std::enable_if_t<std::is_integral_v<T> || std::is_reference_v<T>>>
-    ValueNode(T value): _value(double(value)) {}
+    ValueNode(T value) {
+        if constexpr (std::is_unsigned_v<T> && sizeof(T) >= sizeof(int64_t)) {
+            if (value > T(std::numeric_limits<IntegerValue>::max())) {
+                _value = NumberValue(value);
+                return;
+            }
+        }
+        _value = IntegerValue(value);
+    }
 
     /// Automatically call the constructor of std::variant in other cases.
     template <
@@ -126,26 +191,88 @@ class ValueNode
 
     ~ValueNode() = default;
 
+    /// Construct a STRING value which refers to an external buffer instead of
+    /// owning a copy of it. The buffer must outlive this node and all copies
+    /// of it.
+    static ValueNode view(std::string_view value) {
+        ValueNode node;
+        node._value.emplace<_STRING_VIEW_INDEX>(value);
+        return node;
+    }
+
+    /// Store a copy of `value` as STRING. Unlike assigning a new ValueNode,
+    /// the buffer of a stored STRING is reused if it is large enough.
+    void setString(std::string_view value) {
+        constexpr size_t STRING_INDEX = size_t(TypeTag::STRING);
+        if (auto str = std::get_if<STRING_INDEX>(&_value)) {
+            str->assign(value.data(), value.size());
+        } else {
+            _value.emplace<STRING_INDEX>(value);
+        }
+    }
+
   private:
 
+    /// Same as `Value`, with an extra type for STRING which refers to an
+    /// external buffer.
+    using Storage = std::variant<
+        NoneValue,
+        BoolValue,
+        NumberValue,
+        StringValue,
+        IntegerValue,
+        std::string_view>;
+
+    static constexpr size_t _STRING_VIEW_INDEX = std::variant_size_v<Value>;
+
     /// Store value here.
-    Value _value = NONE;
+    Storage _value = NONE;
 };
 
 class ValueTree;
-
-using ArrayNode = std::vector<ValueTree>;
-using ObjectNode = std::map<std::string, ValueTree>;
+class Path;
+
+/// Containers of `ValueTree` allocate from a `std::pmr::memory_resource`.
+/// By default it is `std::pmr::get_default_resource()`, which behaves like the
+/// global heap. Parsers can build a whole tree from one arena, see the
+/// `resource` overloads of `json::parse` and `ini::parse`.
+using MemoryResource = std::pmr::memory_resource;
+
+using ArrayNode = std::pmr::vector<ValueTree>;
+
+/// Objects are sorted maps by default. Define `C2P_FLAT_OBJECT_NODE` (CMake
+/// option of the same name) to use `FlatMap`, which is faster to search and
+/// keeps the insertion order, e.g. for round-tripping configuration files.
+/// Both support lookup by std::string_view without allocation.
+///
+/// Keys are std::string by default. Define `C2P_INTERNED_KEYS` (CMake option
+/// of the same name) to use `InternedKey`, which stores each distinct key
+/// once, for configs where the same keys repeat in many objects.
+#ifdef C2P_INTERNED_KEYS
+using ObjectKey = InternedKey;
+#else
+using ObjectKey = std::string;
+#endif
+
+#ifdef C2P_FLAT_OBJECT_NODE
+using ObjectNode = FlatMap<ValueTree, ObjectKey>;
+#else
+using ObjectNode = std::pmr::map<ObjectKey, ValueTree, std::less<>>;
+#endif
 
 /// Definition of `ValueTree`.
 class ValueTree
 {
   public:
 
-    enum class State { EMPTY, VALUE, ARRAY, OBJECT };
+    // clang-format off
+    /// The number and order of template types must be consistent with enum `State`.
+    using Node = std::variant< std::monostate, ValueNode, ArrayNode, ObjectNode >;
+    enum class State          { EMPTY,          VALUE,     ARRAY,     OBJECT,    };
+    // clang-format on
 
     /// Get the state of the ValueTree root.
-    State state() const { return _state; }
+    State state() const { return static_cast<State>(_storage().index()); }
 
     /// Return false if is an empty tree.
     operator bool() const { return state() != State::EMPTY; }
@@ -162,44 +289,101 @@ class ValueTree
     /// If the tree state is State::OBJECT.
     bool isObject() const { return state() == State::OBJECT; }
 
+    /// Get the generation of the tree, which changes whenever the tree may be
+    /// modified, i.e. on every call of a non-const member function. Reaching
+    /// a subtree through non-const member functions changes the generation
+    /// of every tree on the way, so the generation of the root covers the
+    /// whole tree. Generations are unique among all trees, see `Path`.
+    ///
+    /// Modifications through references kept from earlier calls are NOT
+    /// tracked. Call `touch()` after them, on the modified tree and on every
+    /// tree on the path to it.
+    uint64_t generation() const { return _generation; }
+
+    /// Change the generation of the tree, see `generation()`.
+    void touch() { _generation = _nextGeneration(); }
+
+    /// Turn the tree into a shared snapshot in O(1). Copies of a shared tree
+    /// are O(1) and share all subtrees with it. Modifying a copy through
+    /// non-const member functions only copies the trees on the way to the
+    /// modification (copy-on-write), never the shared trees themselves, so
+    /// copies can be read and modified by different threads.
+    void share() {
+        if (isShared()) return;
+        touch();
+        ValueTree tree;
+        tree._node = std::move(_node);
+        _node.emplace<_SHARED_INDEX>(
+            std::make_shared<const ValueTree>(std::move(tree))
+        );
+    }
+
+    /// If the tree is a shared snapshot, see `share()`.
+    bool isShared() const { return _node.index() == _SHARED_INDEX; }
+
   public:
 
     /// Clear the tree to an empty state.
     void clear() {
-        _state = State::EMPTY;
-        _value_node = NONE;
-        _array_node.clear();
-        _object_node.clear();
+        touch();
+        _node.emplace<size_t(State::EMPTY)>();
     }
 
     /// Get ValueNode reference.
     /// If current tree root is NOT a value, change it to ValueNode(NONE).
     ValueNode& asValue() {
+        touch();
+        _unshare();
         if (state() != State::VALUE) {
-            clear();
-            _state = State::VALUE;
+            return _node.emplace<size_t(State::VALUE)>();
         }
-        return _value_node;
+        return std::get<size_t(State::VALUE)>(_node);
     }
 
     /// Get ArrayNode reference.
     /// If current tree root is NOT an array, change it to an empty array.
     ArrayNode& asArray() {
+        touch();
+        _unshare();
         if (state() != State::ARRAY) {
-            clear();
-            _state = State::ARRAY;
+            return _node.emplace<size_t(State::ARRAY)>();
         }
-        return _array_node;
+        return std::get<size_t(State::ARRAY)>(_node);
     }
 
     /// Get ObjectNode reference.
     /// If current tree root is NOT an object, change it to an empty object.
     ObjectNode& asObject() {
+        touch();
+        _unshare();
+        if (state() != State::OBJECT) {
+            return _node.emplace<size_t(State::OBJECT)>();
+        }
+        return std::get<size_t(State::OBJECT)>(_node);
+    }
+
+    /// Get ArrayNode reference.
+    /// If current tree root is NOT an array, change it to an empty array which
+    /// allocates from `resource`. The resource must outlive the array.
+    ArrayNode& asArray(MemoryResource* resource) {
+        touch();
+        _unshare();
+        if (state() != State::ARRAY) {
+            return _node.emplace<size_t(State::ARRAY)>(resource);
+        }
+        return std::get<size_t(State::ARRAY)>(_node);
+    }
+
+    /// Get ObjectNode reference.
+    /// If current tree root is NOT an object, change it to an empty object
+    /// which allocates from `resource`. The resource must outlive the object.
+    ObjectNode& asObject(MemoryResource* resource) {
+        touch();
+        _unshare();
         if (state() != State::OBJECT) {
-            clear();
-            _state = State::OBJECT;
+            return _node.emplace<size_t(State::OBJECT)>(resource);
         }
-        return _object_node;
+        return std::get<size_t(State::OBJECT)>(_node);
     }
 
     /// Get subtree reference at specified key.
@@ -217,20 +401,23 @@ class ValueTree
     /// Try to get sub tree (pointer) at specified key.
     /// If state of current tree is NOT State::OBJECT, return nullptr.
     /// If key NOT found, return nullptr.
-    ValueTree* subTree(const std::string& key) {
-        if (state() != State::OBJECT) return nullptr;
-        const auto it = _object_node.find(key);
-        if (it == _object_node.end()) return nullptr;
+    ValueTree* subTree(std::string_view key) {
+        touch();
+        const auto object = getObject();
+        if (!object) return nullptr;
+        const auto it = object->find(key);
+        if (it == object->end()) return nullptr;
         return &(it->second);
     }
 
     /// Try to get sub tree (pointer) at specified key.
     /// If state of current tree is NOT State::OBJECT, return nullptr.
     /// If key NOT found, return nullptr.
-    const ValueTree* subTree(const std::string& key) const {
-        if (state() != State::OBJECT) return nullptr;
-        const auto it = _object_node.find(key);
-        if (it == _object_node.end()) return nullptr;
+    const ValueTree* subTree(std::string_view key) const {
+        const auto object = getObject();
+        if (!object) return nullptr;
+        const auto it = object->find(key);
+        if (it == object->end()) return nullptr;
         return &(it->second);
     }
 
@@ -238,10 +425,12 @@ class ValueTree
     /// If state of current tree is NOT State::OBJECT, return nullptr.
     /// If path NOT found, return nullptr.
     template <typename... Args>
-    ValueTree* subTree(const std::string& key, Args&&... args) {
-        if (state() != State::OBJECT) return nullptr;
-        const auto it = _object_node.find(key);
-        if (it == _object_node.end()) return nullptr;
+    ValueTree* subTree(std::string_view key, Args&&... args) {
+        touch();
+        const auto object = getObject();
+        if (!object) return nullptr;
+        const auto it = object->find(key);
+        if (it == object->end()) return nullptr;
         return it->second.subTree(std::forward<Args>(args)...);
     }
 
@@ -249,10 +438,11 @@ class ValueTree
     /// If state of current tree is NOT State::OBJECT, return nullptr.
     /// If path NOT found, return nullptr.
     template <typename... Args>
-    const ValueTree* subTree(const std::string& key, Args&&... args) const {
-        if (state() != State::OBJECT) return nullptr;
-        const auto it = _object_node.find(key);
-        if (it == _object_node.end()) return nullptr;
+    const ValueTree* subTree(std::string_view key, Args&&... args) const {
+        const auto object = getObject();
+        if (!object) return nullptr;
+        const auto it = object->find(key);
+        if (it == object->end()) return nullptr;
         return it->second.subTree(std::forward<Args>(args)...);
     }
 
@@ -260,18 +450,21 @@ class ValueTree
     /// If state of current tree is NOT State::ARRAY, return nullptr.
     /// If index NOT found, return nullptr.
     ValueTree* subTree(size_t index) {
-        if (state() != State::ARRAY) return nullptr;
-        if (index >= _array_node.size()) return nullptr;
-        return &(_array_node[index]);
+        touch();
+        const auto array = getArray();
+        if (!array) return nullptr;
+        if (index >= array->size()) return nullptr;
+        return &((*array)[index]);
     }
 
     /// Try to get sub tree (pointer) at specified index.
     /// If state of current tree is NOT State::ARRAY, return nullptr.
     /// If index NOT found, return nullptr.
     const ValueTree* subTree(size_t index) const {
-        if (state() != State::ARRAY) return nullptr;
-        if (index >= _array_node.size()) return nullptr;
-        return &(_array_node[index]);
+        const auto array = getArray();
+        if (!array) return nullptr;
+        if (index >= array->size()) return nullptr;
+        return &((*array)[index]);
     }
 
     /// Try to get sub tree (pointer) at specified path.
@@ -279,9 +472,11 @@ class ValueTree
     /// If path NOT found, return nullptr.
     template <typename... Args>
     ValueTree* subTree(size_t index, Args&&... args) {
-        if (state() != State::ARRAY) return nullptr;
-        if (index >= _array_node.size()) return nullptr;
-        return _array_node[index].subTree(std::forward<Args>(args)...);
+        touch();
+        const auto array = getArray();
+        if (!array) return nullptr;
+        if (index >= array->size()) return nullptr;
+        return (*array)[index].subTree(std::forward<Args>(args)...);
     }
 
     /// Try to get sub tree (pointer) at specified path.
@@ -289,23 +484,34 @@ class ValueTree
     /// If path NOT found, return nullptr.
     template <typename... Args>
     const ValueTree* subTree(size_t index, Args&&... args) const {
-        if (state() != State::ARRAY) return nullptr;
-        if (index >= _array_node.size()) return nullptr;
-        return _array_node[index].subTree(std::forward<Args>(args)...);
+        const auto array = getArray();
+        if (!array) return nullptr;
+        if (index >= array->size()) return nullptr;
+        return (*array)[index].subTree(std::forward<Args>(args)...);
     }
 
+    /// Try to get sub tree (pointer) at specified precompiled path, see `Path`.
+    /// If path NOT found, return nullptr.
+    ValueTree* subTree(const Path& path);
+
+    /// Try to get sub tree (pointer) at specified precompiled path, see `Path`.
+    /// If path NOT found, return nullptr.
+    const ValueTree* subTree(const Path& path) const;
+
   public:
 
     /// Try to get ValueNode pointer.
     /// If state of current tree is NOT State::VALUE, return nullptr.
     ValueNode* getValue() {
-        return (state() == State::VALUE) ? &_value_node : nullptr;
+        touch();
+        _unshare();
+        return std::get_if<size_t(State::VALUE)>(&_node);
     }
 
     /// Try to get ValueNode pointer.
     /// If state of current tree is NOT State::VALUE, return nullptr.
     const ValueNode* getValue() const {
-        return (state() == State::VALUE) ? &_value_node : nullptr;
+        return std::get_if<size_t(State::VALUE)>(&_storage());
     }
 
     /// Try to get ValueNode pointer at specified path.
@@ -333,13 +539,15 @@ class ValueTree
     /// Try to get ArrayNode pointer.
     /// If state of current tree is NOT State::ARRAY, return nullptr.
     ArrayNode* getArray() {
-        return (state() == State::ARRAY) ? &_array_node : nullptr;
+        touch();
+        _unshare();
+        return std::get_if<size_t(State::ARRAY)>(&_node);
     }
 
     /// Try to get ArrayNode pointer.
     /// If state of current tree is NOT State::ARRAY, return nullptr.
     const ArrayNode* getArray() const {
-        return (state() == State::ARRAY) ? &_array_node : nullptr;
+        return std::get_if<size_t(State::ARRAY)>(&_storage());
     }
 
     /// Try to get ArrayNode pointer at specified path.
@@ -367,13 +575,15 @@ class ValueTree
     /// Try to get ObjectNode pointer.
     /// If state of current tree is NOT State::OBJECT, return nullptr.
     ObjectNode* getObject() {
-        return (state() == State::OBJECT) ? &_object_node : nullptr;
+        touch();
+        _unshare();
+        return std::get_if<size_t(State::OBJECT)>(&_node);
     }
 
     /// Try to get ObjectNode pointer.
     /// If state of current tree is NOT State::OBJECT, return nullptr.
     const ObjectNode* getObject() const {
-        return (state() == State::OBJECT) ? &_object_node : nullptr;
+        return std::get_if<size_t(State::OBJECT)>(&_storage());
     }
 
     /// Try to get ObjectNode pointer at specified path.
@@ -406,8 +616,9 @@ class ValueTree
     /// return std::nullopt.
     template <TypeTag typeTag>
     auto value() const -> std::optional<typename TypeOfTag<typeTag>::type> {
-        if (state() != State::VALUE) return std::nullopt;
-        return _value_node.value<typeTag>();
+        const auto node = getValue();
+        if (!node) return std::nullopt;
+        return node->template value<typeTag>();
     }
 
     /// Try to get stored value at specified path.
@@ -425,14 +636,25 @@ class ValueTree
 
   public:
 
-    ~ValueTree() { clear(); }
+    /// Subtrees deeper than `_MAX_RECURSION_DEPTH` are destroyed without
+    /// recursion, so trees of any depth can be destroyed.
+    ~ValueTree() {
+        if (!_hasSubTrees()) return;
+        if (_recursionDepth < _MAX_RECURSION_DEPTH) {
+            const _RecursionGuard guard;
+            _node.emplace<size_t(State::EMPTY)>();
+        } else if (_hasNestedSubTrees()) {
+            _destroySubTrees();
+        }
+    }
 
     /// Default constructor. As an empty tree.
     ValueTree() = default;
 
-    ValueTree(const ValueNode& node): _state(State::VALUE), _value_node(node) {}
+    ValueTree(const ValueNode& node)
+        : _node(std::in_place_index<size_t(State::VALUE)>, node) {}
     ValueTree(ValueNode&& node)
-        : _state(State::VALUE), _value_node(std::move(node)) {}
+        : _node(std::in_place_index<size_t(State::VALUE)>, std::move(node)) {}
     ValueTree& operator=(const ValueNode& node) {
         asValue() = node;
         return *this;
@@ -442,10 +664,40 @@ class ValueTree
         return *this;
     }
 
-    ValueTree(const ValueTree&) = default;
-    ValueTree(ValueTree&&) = default;
-    ValueTree& operator=(const ValueTree&) = default;
-    ValueTree& operator=(ValueTree&&) = default;
+    /// Copies and moves get new generations, see `generation()`.
+    /// Subtrees deeper than `_MAX_RECURSION_DEPTH` are copied without
+    /// recursion, so trees of any depth can be copied.
+    ValueTree(const ValueTree& other)
+        : _node(
+              _recursionDepth < _MAX_RECURSION_DEPTH
+                      || !other._hasNestedSubTrees()
+                  ? _copyRecursively(other)
+                  : Storage()
+          ) {
+        // A deep `other` is left empty above.
+        if (_node.index() != other._node.index()) _copyFrom(other);
+    }
+    ValueTree(ValueTree&& other) noexcept(
+        std::is_nothrow_move_constructible_v<Storage>
+    )
+        : _node(std::move(other._node)) {
+        other._resetMovedFrom();
+    }
+    ValueTree& operator=(const ValueTree& other) {
+        touch();
+        // Copy first, `other` may be a subtree of this tree.
+        ValueTree copy(other);
+        _node = std::move(copy._node);
+        return *this;
+    }
+    ValueTree& operator=(ValueTree&& other) noexcept(
+        std::is_nothrow_move_assignable_v<Storage>
+    ) {
+        touch();
+        _node = std::move(other._node);
+        other._resetMovedFrom();
+        return *this;
+    }
 
     /// From std::vector to ValueTree with State::ARRAY.
     template <typename T>
@@ -471,11 +723,279 @@ class ValueTree
 
   private:
 
-    State _state = State::EMPTY;
+    /// A tree shared by several copies, see `share()`. Never modified.
+    using SharedNode = std::shared_ptr<const ValueTree>;
+
+    /// Same as `Node`, with an extra type for shared trees.
+    using Storage = std::variant<
+        std::monostate,
+        ValueNode,
+        ArrayNode,
+        ObjectNode,
+        SharedNode>;
+
+    static constexpr size_t _SHARED_INDEX = std::variant_size_v<Node>;
+
+    /// The storage of this tree, or of the tree it shares. A shared tree
+    /// never shares another one.
+    const Storage& _storage() const {
+        if (_node.index() == _SHARED_INDEX) {
+            return std::get<_SHARED_INDEX>(_node)->_node;
+        }
+        return _node;
+    }
 
-    ValueNode _value_node = NONE;
-    ArrayNode _array_node = {};
-    ObjectNode _object_node = {};
+    /// After being moved from, become empty instead of holding a null shared
+    /// tree.
+    void _resetMovedFrom() {
+        touch();
+        if (_node.index() == _SHARED_INDEX) {
+            _node.emplace<size_t(State::EMPTY)>();
+        }
+    }
+
+    /// Before modification, replace a shared tree by a copy of its top level,
+    /// whose subtrees share the subtrees of the shared tree.
+    void _unshare() {
+        if (_node.index() != _SHARED_INDEX) return;
+        const SharedNode shared = std::move(std::get<_SHARED_INDEX>(_node));
+        const auto shareSubTree = [&shared](const ValueTree& subTree) {
+            ValueTree tree;
+            if (subTree._node.index() == _SHARED_INDEX) {
+                tree._node = subTree._node;
+            } else {
+                // Keep the whole shared tree alive, pointing to the subtree.
+                tree._node.emplace<_SHARED_INDEX>(shared, &subTree);
+            }
+            return tree;
+        };
+        switch (shared->state()) {
+            case State::EMPTY: {
+                _node.emplace<size_t(State::EMPTY)>();
+            } break;
+            case State::VALUE: {
+                _node.emplace<size_t(State::VALUE)>(*shared->getValue());
+            } break;
+            case State::ARRAY: {
+                const auto& source = *shared->getArray();
+                auto& array = _node.emplace<size_t(State::ARRAY)>();
+                array.reserve(source.size());
+                for (const auto& subTree: source) {
+                    array.push_back(shareSubTree(subTree));
+                }
+            } break;
+            case State::OBJECT: {
+                const auto& source = *shared->getObject();
+                auto& object = _node.emplace<size_t(State::OBJECT)>();
+                for (const auto& [key, subTree]: source) {
+                    object.emplace_hint(
+                        object.end(), key, shareSubTree(subTree)
+                    );
+                }
+            } break;
+        }
+    }
+
+    /// Whether this tree is an array or object with subtrees.
+    bool _hasSubTrees() const {
+        switch (_node.index()) {
+            case size_t(State::ARRAY):
+                return !std::get<size_t(State::ARRAY)>(_node).empty();
+            case size_t(State::OBJECT):
+                return !std::get<size_t(State::OBJECT)>(_node).empty();
+            default: return false;
+        }
+    }
+
+    /// Whether a subtree of this tree has subtrees.
+    bool _hasNestedSubTrees() const {
+        const auto hasSubTrees = [](const ValueTree& subTree) {
+            return subTree._hasSubTrees();
+        };
+        if (const auto array = std::get_if<size_t(State::ARRAY)>(&_node)) {
+            return std::any_of(array->begin(), array->end(), hasSubTrees);
+        }
+        if (const auto object = std::get_if<size_t(State::OBJECT)>(&_node)) {
+            return std::any_of(
+                object->begin(),
+                object->end(),
+                [&hasSubTrees](const auto& member) {
+                    return hasSubTrees(member.second);
+                }
+            );
+        }
+        return false;
+    }
+
+    /// Subtrees up to this depth are copied and destroyed recursively by the
+    /// containers, which is faster, e.g. `std::map` copies without
+    /// rebalancing. Deeper ones use an explicit stack instead.
+    static constexpr size_t _MAX_RECURSION_DEPTH = 64;
+
+    /// Depth of the copy constructors and destructors being called in this
+    /// thread.
+    static inline thread_local size_t _recursionDepth = 0;
+
+    struct _RecursionGuard {
+        _RecursionGuard() { ++_recursionDepth; }
+        ~_RecursionGuard() { --_recursionDepth; }
+    };
+
+    static Storage _copyRecursively(const ValueTree& other) {
+        const _RecursionGuard guard;
+        return other._node;
+    }
+
+    /// Copy `other` into this empty tree without recursion, with an explicit
+    /// stack of the arrays and objects on the path to the current subtree.
+    void _copyFrom(const ValueTree& other) {
+        struct Frame {
+            const ValueTree* from;
+            ValueTree* to;
+
+            /// Next element of an array, or next member of an object.
+            size_t index = 0;
+            ObjectNode::const_iterator fromIt{};
+            ObjectNode::iterator toIt{};
+        };
+        std::vector<Frame> stack;
+        // Copy `from` into `to`, leaving the arrays and objects with subtrees
+        // in it empty, to be copied from a frame pushed for `from`.
+        const auto copyNode = [&stack](const ValueTree& from, ValueTree& to) {
+            if (!from._hasNestedSubTrees()) {
+                // Only values in it, copied at once.
+                to._node = from._node;
+                return;
+            }
+            Frame frame{ &from, &to };
+            if (from._node.index() == size_t(State::ARRAY)) {
+                const auto& source = std::get<size_t(State::ARRAY)>(from._node);
+                auto& array = to._node.emplace<size_t(State::ARRAY)>();
+                // Reserved at once, so that elements stay in place while
+                // frames point to them.
+                array.reserve(source.size());
+                for (const auto& subTree: source) {
+                    if (subTree._hasSubTrees()) array.emplace_back();
+                    else array.push_back(subTree);
+                }
+            } else {
+                const auto& source =
+                    std::get<size_t(State::OBJECT)>(from._node);
+                auto& object = to._node.emplace<size_t(State::OBJECT)>();
+                // All members are inserted at once, since inserting may move
+                // the elements of a FlatMap.
+                for (const auto& [key, subTree]: source) {
+                    if (subTree._hasSubTrees()) {
+                        object.emplace_hint(object.end(), key, ValueTree());
+                    } else {
+                        object.emplace_hint(object.end(), key, subTree);
+                    }
+                }
+                frame.fromIt = source.begin();
+                frame.toIt = object.begin();
+            }
+            stack.push_back(frame);
+        };
+        copyNode(other, *this);
+        while (!stack.empty()) {
+            // `copyNode` may push a frame, so `frame` is NOT used after it.
+            auto& frame = stack.back();
+            const ValueTree* from = nullptr;
+            ValueTree* to = nullptr;
+            if (frame.from->_node.index() == size_t(State::ARRAY)) {
+                const auto& source =
+                    std::get<size_t(State::ARRAY)>(frame.from->_node);
+                auto& array = std::get<size_t(State::ARRAY)>(frame.to->_node);
+                while (!from && frame.index < source.size()) {
+                    const size_t idx = frame.index++;
+                    if (!source[idx]._hasSubTrees()) continue;
+                    from = &source[idx];
+                    to = &array[idx];
+                }
+            } else {
+                const auto& source =
+                    std::get<size_t(State::OBJECT)>(frame.from->_node);
+                while (!from && frame.fromIt != source.end()) {
+                    const auto& subTree = (frame.fromIt++)->second;
+                    auto& dest = (frame.toIt++)->second;
+                    if (!subTree._hasSubTrees()) continue;
+                    from = &subTree;
+                    to = &dest;
+                }
+            }
+            if (from) copyNode(*from, *to);
+            else stack.pop_back();
+        }
+    }
+
+    /// Destroy the subtrees without recursion, with an explicit stack of the
+    /// arrays and objects on the path to the current subtree. Each one is
+    /// emptied after its subtrees, so that it only holds values when
+    /// destroyed, and those only holding values are emptied at once.
+    void _destroySubTrees() noexcept {
+        struct Frame {
+            ValueTree* tree;
+
+            /// Next element of an array, or next member of an object.
+            size_t index = 0;
+            ObjectNode::iterator it{};
+        };
+        std::vector<Frame> stack;
+        const auto push = [&stack](ValueTree& tree) {
+            Frame frame{ &tree };
+            if (tree._node.index() == size_t(State::OBJECT)) {
+                frame.it = std::get<size_t(State::OBJECT)>(tree._node).begin();
+            }
+            stack.push_back(frame);
+        };
+        // Empty `subTree` if it only holds values, otherwise return it.
+        const auto clear = [](ValueTree& subTree) -> ValueTree* {
+            if (!subTree._hasSubTrees()) return nullptr;
+            if (subTree._hasNestedSubTrees()) return &subTree;
+            subTree._node.emplace<size_t(State::EMPTY)>();
+            return nullptr;
+        };
+        push(*this);
+        while (!stack.empty()) {
+            // `push` may reallocate, so `frame` is NOT used after it.
+            auto& frame = stack.back();
+            ValueTree* next = nullptr;
+            if (frame.tree->_node.index() == size_t(State::ARRAY)) {
+                auto& array = std::get<size_t(State::ARRAY)>(frame.tree->_node);
+                while (!next && frame.index < array.size()) {
+                    next = clear(array[frame.index++]);
+                }
+            } else {
+                auto& object =
+                    std::get<size_t(State::OBJECT)>(frame.tree->_node);
+                while (!next && frame.it != object.end()) {
+                    next = clear((frame.it++)->second);
+                }
+            }
+            if (next) {
+                push(*next);
+                continue;
+            }
+            // This tree is destroyed by the caller.
+            if (frame.tree != this) {
+                frame.tree->_node.emplace<size_t(State::EMPTY)>();
+            }
+            stack.pop_back();
+        }
+    }
+
+    /// Return a generation unique among all trees. Each thread counts in its
+    /// own range, so only its first call synchronizes.
+    static uint64_t _nextGeneration() {
+        static std::atomic<uint64_t> threadCount{ 0 };
+        thread_local uint64_t generation = threadCount.fetch_add(1) << 40;
+        return ++generation;
+    }
+
+    /// Only the node of current state is constructed.
+    Storage _node;
+
+    uint64_t _generation = _nextGeneration();
 };
 
 /// Convert ValueTree::State to string.
@@ -489,6 +1009,177 @@ inline std::string to_string(ValueTree::State state) {
     }
 }
 
+/// Precompiled path to a subtree, for lookups repeated many times.
+///
+/// Build it once from keys and indices, or from a string like
+/// "info.address.zip" or "roommates[2]", and pass it to `ValueTree::subTree`,
+/// `ValueTree::value` etc. instead of the keys and indices.
+///
+/// A Path caches the subtrees on the way of its last lookup with their
+/// generations, see `ValueTree::generation()`. Looking up the same tree
+/// again only compares generations, unless the tree has been modified.
+///
+/// Lookups update the cache, so one Path must NOT be used by several threads
+/// at the same time.
+class Path
+{
+  public:
+
+    /// A key of an object, or an index of an array.
+    using Step = std::variant<std::string, size_t>;
+
+    /// Empty path, refers to the tree itself.
+    Path() = default;
+
+    explicit Path(std::vector<Step> steps): _steps(std::move(steps)) {}
+
+    /// From keys (convertible to std::string_view) and indices (integral),
+    /// in the same form as the arguments of `ValueTree::subTree`.
+    template <typename... Args>
+    static Path from(Args&&... args) {
+        std::vector<Step> steps;
+        steps.reserve(sizeof...(args));
+        (steps.push_back(_toStep(std::forward<Args>(args))), ...);
+        return Path(std::move(steps));
+    }
+
+    /// From a string of keys separated by '.', with array indices in
+    /// brackets, e.g. "roommates[2].name". Keys cannot contain '.' or '['.
+    /// Return std::nullopt if the string is invalid.
+    static std::optional<Path> parse(std::string_view str) {
+        std::vector<Step> steps;
+        if (str.empty()) return Path();
+        size_t pos = 0;
+        while (true) {
+            // Key, maybe empty if followed by an index.
+            const size_t keyEnd =
+                std::min(str.find_first_of(".[", pos), str.size());
+            if (keyEnd > pos || keyEnd == str.size() || str[keyEnd] == '.') {
+                steps.emplace_back(std::string(str.substr(pos, keyEnd - pos)));
+            }
+            pos = keyEnd;
+            // Indices.
+            while (pos < str.size() && str[pos] == '[') {
+                const size_t indexEnd = str.find(']', pos);
+                if (indexEnd == std::string_view::npos || indexEnd == pos + 1) {
+                    return std::nullopt;
+                }
+                size_t index = 0;
+                const auto [end, ec] = std::from_chars(
+                    str.data() + pos + 1, str.data() + indexEnd, index
+                );
+                if (ec != std::errc() || end != str.data() + indexEnd) {
+                    return std::nullopt;
+                }
+                steps.emplace_back(index);
+                pos = indexEnd + 1;
+            }
+            if (pos == str.size()) break;
+            if (str[pos] != '.') return std::nullopt;
+            ++pos;
+        }
+        return Path(std::move(steps));
+    }
+
+    const std::vector<Step>& steps() const { return _steps; }
+
+    /// Look up the subtree at this path. Return nullptr if NOT found.
+    const ValueTree* resolve(const ValueTree& tree) const {
+        if (_steps.empty()) return &tree;
+        if (_isCached(tree)) return _target;
+
+        _cache.clear();
+        const ValueTree* node = &tree;
+        for (const auto& step: _steps) {
+            _cache.emplace_back(node, node->generation());
+            if (const auto key = std::get_if<std::string>(&step)) {
+                node = node->subTree(std::string_view(*key));
+            } else {
+                node = node->subTree(std::get<size_t>(step));
+            }
+            if (!node) break;
+        }
+        _target = node;
+        return _target;
+    }
+
+    /// Look up the subtree at this path for modification, see the non-const
+    /// `ValueTree::subTree`. Return nullptr if NOT found.
+    ///
+    /// The trees on the way are touched after the lookup, and the cache is
+    /// updated to their new generations, so the next lookup still hits it.
+    /// If a tree on the way is shared, see `ValueTree::share()`, the steps
+    /// are taken again through the non-const `ValueTree::subTree`, which
+    /// copies the shared trees on the way.
+    ValueTree* resolve(ValueTree& tree) const {
+        const ValueTree* target = resolve(std::as_const(tree));
+        if (!target) return nullptr;
+        if (_cache.empty()) tree.touch();
+        for (const auto& [node, generation]: _cache) {
+            if (node->isShared()) return _resolveUnshared(tree);
+        }
+        for (auto& [node, generation]: _cache) {
+            const_cast<ValueTree*>(node)->touch();
+            generation = node->generation();
+        }
+        return const_cast<ValueTree*>(target);
+    }
+
+  private:
+
+    /// Look up the subtree at this path for modification, unsharing the
+    /// trees on the way. The cache is dropped, since they are replaced.
+    ValueTree* _resolveUnshared(ValueTree& tree) const {
+        _cache.clear();
+        ValueTree* node = &tree;
+        for (const auto& step: _steps) {
+            if (const auto key = std::get_if<std::string>(&step)) {
+                node = node->subTree(std::string_view(*key));
+            } else {
+                node = node->subTree(std::get<size_t>(step));
+            }
+            if (!node) break;
+        }
+        return node;
+    }
+
+    template <typename T>
+    static Step _toStep(T&& arg) {
+        if constexpr (std::is_integral_v<std::decay_t<T>>) {
+            return Step(std::in_place_index<1>, size_t(arg));
+        } else {
+            return Step(std::in_place_index<0>, std::string_view(arg));
+        }
+    }
+
+    /// If the last lookup was on `tree`, and no subtree on the way has been
+    /// modified since then. Subtrees are checked from the root, so each one
+    /// is only accessed when its parent is unmodified.
+    bool _isCached(const ValueTree& tree) const {
+        if (_cache.empty() || _cache.front().first != &tree) return false;
+        for (const auto& [node, generation]: _cache) {
+            if (node->generation() != generation) return false;
+        }
+        return true;
+    }
+
+    std::vector<Step> _steps;
+
+    /// Subtrees on the way of the last lookup, with their generations.
+    mutable std::vector<std::pair<const ValueTree*, uint64_t>> _cache;
+
+    /// Result of the last lookup.
+    mutable const ValueTree* _target = nullptr;
+};
+
+inline ValueTree* ValueTree::subTree(const Path& path) {
+    return path.resolve(*this);
+}
+
+inline const ValueTree* ValueTree::subTree(const Path& path) const {
+    return path.resolve(*this);
+}
+
 }  // namespace c2p
 
 #endif  // __C2P_VALUE_TREE_HPP__
@@ -105,7 +105,7 @@ bool Parser::_constructFrom(
     // Record value arguments.
     _valueArgs = cg.valueArgs;
     for (size_t idx = 0; idx < _valueArgs.size(); ++idx) {
-        const auto& valueArg = _valueArgs[idx];
+        auto& valueArg = _valueArgs[idx];
 
         if (valueArg.name.empty()) {
             logger.error(commandStr + ": Value argument name cannot be empty.");
@@ -120,6 +120,13 @@ bool Parser::_constructFrom(
 
         // Check the default value type.
         if (valueArg.defaultValue.has_value()) {
+            // Integer literals are accepted as NUMBER default values.
+            if (valueArg.typeTag == TypeTag::NUMBER
+                && valueArg.defaultValue->isInteger())
+            {
+                valueArg.defaultValue =
+                    *valueArg.defaultValue->value<TypeTag::NUMBER>();
+            }
             if (valueArg.defaultValue->typeTag() != valueArg.typeTag) {
                 logger.error(
                     commandStr + ": Default value type mismatch: \""
@@ -300,7 +307,23 @@ static bool _parseValue(
                 }
             }
             if (pos < valueStr.size()) return false;
-            node = std::stod(valueStr);
+            const auto number = toDouble(valueStr);
+            if (!number) return false;
+            node = *number;
+            return true;
+        } break;
+        case TypeTag::INTEGER: {
+            if (valueStr.empty()) return false;
+            uint32_t pos = 0;
+            if (valueStr[pos] == '+' || valueStr[pos] == '-') ++pos;
+            if (pos >= valueStr.size()) return false;
+            while (pos < valueStr.size() && std::isdigit(valueStr[pos])) {
+                ++pos;
+            }
+            if (pos < valueStr.size()) return false;
+            const auto integer = toInteger(valueStr);
+            if (!integer) return false;
+            node = *integer;
             return true;
         } break;
         case TypeTag::STRING: {
@@ -419,6 +442,11 @@ bool Parser::_parse(
     const std::string commandStr = preCommandStr + _command;
 
     // Insert argument fields.
+    // Insert all of them before taking references, inserting into an object
+    // may invalidate references to its elements, see `FlatMap`.
+    object["flagArgs"];
+    object["valueArgs"];
+    object["positionalArgs"];
     auto& flagArgs = object["flagArgs"].asArray();
     auto& valueArgs = object["valueArgs"].asObject();
     auto& positionalArgs = object["positionalArgs"].asArray();
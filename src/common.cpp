@@ -2,6 +2,56 @@
 
 namespace c2p {
 
+Sink::Sink(std::string& output): _output(&output) {
+    const size_t size = output.size();
+    output.resize(std::max(output.capacity(), size + 256));
+    _begin = output.data();
+    _cursor = _begin + size;
+    _limit = _begin + output.size();
+}
+
+Sink::Sink(std::FILE* file, size_t bufferSize)
+    : Sink(
+          [file](const char* data, size_t size) {
+              std::fwrite(data, 1, size, file);
+          },
+          bufferSize
+      ) {}
+
+Sink::Sink(WriteCallback writeCallback, size_t bufferSize)
+    : _writeCallback(std::move(writeCallback)),
+      _buffer(new char[std::max<size_t>(bufferSize, 1)]),
+      _bufferSize(std::max<size_t>(bufferSize, 1)) {
+    _begin = _buffer.get();
+    _cursor = _begin;
+    _limit = _begin + _bufferSize;
+}
+
+void Sink::flush() {
+    if (_output) {
+        // Drop the unused tail. The next write grows the string again.
+        _output->resize(_cursor - _begin);
+        _begin = _output->data();
+        _cursor = _begin + _output->size();
+        _limit = _cursor;
+    } else if (_cursor != _begin) {
+        _writeCallback(_begin, _cursor - _begin);
+        _cursor = _begin;
+    }
+}
+
+void Sink::_overflow(size_t required) {
+    if (_output) {
+        const size_t used = _cursor - _begin;
+        _output->resize(std::max(used * 2, used + required));
+        _begin = _output->data();
+        _cursor = _begin + used;
+        _limit = _begin + _output->size();
+    } else {
+        flush();
+    }
+}
+
 #ifdef PROJECT_VERSION
 const std::string ProjectVersion = PROJECT_VERSION;
 #else
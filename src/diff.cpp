@@ -0,0 +1,159 @@
+#include "c2p/diff.hpp"
+
+#include <vector>
+
+namespace c2p {
+
+/// Arrays or objects at the same path of both trees, whose subtrees are
+/// being compared by `_diff`.
+struct _DiffFrame {
+    const ValueTree* from = nullptr;
+    const ValueTree* to = nullptr;
+
+    /// Index of the next pair of elements of arrays, which counts only the
+    /// non-empty ones, and their positions in `from` and `to`.
+    size_t index = 0;
+    size_t fromPos = 0;
+    size_t toPos = 0;
+
+    /// Next member of `from`, then of `to` to find the added ones.
+    ObjectNode::const_iterator fromIt;
+    ObjectNode::const_iterator toIt;
+};
+
+/// Find the differences between NOT empty trees `from` and `to`, with a stack
+/// of the arrays and objects being compared instead of recursion, so that
+/// trees of any depth can be compared. Changes are found depth-first, in the
+/// order of `from` and then of `to`.
+static void _diff(
+    const ValueTree& from,
+    const ValueTree& to,
+    SubtreeHashes& hashes,
+    std::vector<Change>& changes
+) {
+    std::vector<Path::Step> steps;
+    std::vector<_DiffFrame> frames;
+    const auto addChange = [&](Change::Kind kind) {
+        changes.push_back({ kind, Path(steps) });
+    };
+    // Compare NOT empty trees at `steps`, and push a frame to compare their
+    // subtrees if they differ. Return whether a frame is pushed.
+    const auto compare = [&](const ValueTree& from, const ValueTree& to) {
+        if (from.state() != to.state()) {
+            addChange(Change::Kind::CHANGED);
+            return false;
+        }
+        if (from.isValue()) {
+            if (*from.getValue() != *to.getValue()) {
+                addChange(Change::Kind::CHANGED);
+            }
+            return false;
+        }
+        // Subtrees shared by both trees refer to the same node, see
+        // `ValueTree::share()`.
+        const bool shared = from.isArray()
+            ? from.getArray() == to.getArray()
+            : from.getObject() == to.getObject();
+        if (shared || hashes.hash(from) == hashes.hash(to)) return false;
+
+        _DiffFrame frame;
+        frame.from = &from;
+        frame.to = &to;
+        if (from.isObject()) {
+            frame.fromIt = from.getObject()->begin();
+            frame.toIt = to.getObject()->begin();
+        }
+        frames.push_back(frame);
+        return true;
+    };
+
+    compare(from, to);
+    while (!frames.empty()) {
+        // `compare` may push a frame, so `frame` is NOT used after it.
+        auto& frame = frames.back();
+        const ValueTree* fromSubTree = nullptr;
+        const ValueTree* toSubTree = nullptr;
+        if (frame.from->isArray()) {
+            const auto& fromArray = *frame.from->getArray();
+            const auto& toArray = *frame.to->getArray();
+            while (!fromSubTree) {
+                auto& fromPos = frame.fromPos;
+                auto& toPos = frame.toPos;
+                while (fromPos < fromArray.size() && !fromArray[fromPos]) {
+                    ++fromPos;
+                }
+                while (toPos < toArray.size() && !toArray[toPos]) ++toPos;
+                const bool inFrom = fromPos < fromArray.size();
+                const bool inTo = toPos < toArray.size();
+                if (!inFrom && !inTo) break;
+                steps.emplace_back(frame.index++);
+                if (inFrom && inTo) {
+                    fromSubTree = &fromArray[fromPos++];
+                    toSubTree = &toArray[toPos++];
+                    break;
+                }
+                if (inFrom) {
+                    addChange(Change::Kind::REMOVED);
+                    ++fromPos;
+                } else {
+                    addChange(Change::Kind::ADDED);
+                    ++toPos;
+                }
+                steps.pop_back();
+            }
+        } else {
+            const auto& fromObject = *frame.from->getObject();
+            const auto& toObject = *frame.to->getObject();
+            while (!fromSubTree && frame.fromIt != fromObject.end()) {
+                const auto& [key, subTree] = *frame.fromIt++;
+                if (subTree.isEmpty()) continue;
+                steps.emplace_back(key);
+                const auto it = toObject.find(key);
+                if (it != toObject.end() && !it->second.isEmpty()) {
+                    fromSubTree = &subTree;
+                    toSubTree = &it->second;
+                    break;
+                }
+                addChange(Change::Kind::REMOVED);
+                steps.pop_back();
+            }
+            while (!fromSubTree && frame.toIt != toObject.end()) {
+                const auto& [key, subTree] = *frame.toIt++;
+                if (subTree.isEmpty()) continue;
+                const auto it = fromObject.find(key);
+                if (it != fromObject.end() && !it->second.isEmpty()) continue;
+                steps.emplace_back(key);
+                addChange(Change::Kind::ADDED);
+                steps.pop_back();
+            }
+        }
+
+        if (!fromSubTree) {
+            // Steps of frames but the first one are popped with them.
+            frames.pop_back();
+            if (!frames.empty()) steps.pop_back();
+            continue;
+        }
+        if (!compare(*fromSubTree, *toSubTree)) steps.pop_back();
+    }
+}
+
+std::vector<Change> diff(
+    const ValueTree& from,
+    const ValueTree& to,
+    SubtreeHashes& hashes
+) {
+    std::vector<Change> changes;
+    if (from.isEmpty() && to.isEmpty()) return changes;
+    if (from.isEmpty()) changes.push_back({ Change::Kind::ADDED, Path() });
+    else if (to.isEmpty()) changes.push_back({ Change::Kind::REMOVED, Path() });
+    else _diff(from, to, hashes, changes);
+    return changes;
+}
+
+std::vector<Change> diff(const ValueTree& from, const ValueTree& to) {
+    SubtreeHashes hashes;
+    return diff(from, to, hashes);
+}
+
+}  // namespace c2p
@@ -0,0 +1,163 @@
+#include "file_io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define C2P_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace c2p {
+
+/// Allocate `size` bytes in 64-bit words, so that they are aligned to 8.
+static std::shared_ptr<char> _allocate(size_t size) {
+    const size_t words = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    const std::shared_ptr<uint64_t[]> buffer(new uint64_t[words]());
+    return std::shared_ptr<char>(buffer, reinterpret_cast<char*>(buffer.get()));
+}
+
+#ifdef C2P_HAS_MMAP
+
+std::shared_ptr<const char>
+mapFile(const std::string& path, size_t& size, const Logger& logger) {
+    size = 0;
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        logger.error(path + ": Cannot open file: " + std::strerror(errno));
+        return nullptr;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        logger.error(path + ": Cannot stat file: " + std::strerror(errno));
+        ::close(fd);
+        return nullptr;
+    }
+    size = size_t(st.st_size);
+
+    // Empty files cannot be mapped.
+    if (size > 0 && S_ISREG(st.st_mode)) {
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            ::close(fd);
+            return std::shared_ptr<const char>(
+                static_cast<const char*>(mapped),
+                [size](const char* data) {
+                    ::munmap(const_cast<char*>(data), size);
+                }
+            );
+        }
+    }
+
+    // Fall back to reading, e.g. for pipes or file systems without mmap.
+    // One more byte than the size, so that the end of file is read without
+    // growing the buffer.
+    size_t capacity = size + 1;
+    std::shared_ptr<char> buffer = _allocate(capacity);
+    size_t done = 0;
+    while (true) {
+        const ssize_t n = ::read(fd, buffer.get() + done, capacity - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            logger.error(path + ": Cannot read file: " + std::strerror(errno));
+            ::close(fd);
+            return nullptr;
+        }
+        if (n == 0) break;
+        done += size_t(n);
+        if (done == capacity) {
+            // The size is unknown for pipes, or the file has grown.
+            capacity = std::max<size_t>(capacity * 2, 4096);
+            std::shared_ptr<char> grown = _allocate(capacity);
+            std::memcpy(grown.get(), buffer.get(), done);
+            buffer = std::move(grown);
+        }
+    }
+    ::close(fd);
+    size = done;
+    return buffer;
+}
+
+#else
+
+std::shared_ptr<const char>
+mapFile(const std::string& path, size_t& size, const Logger& logger) {
+    size = 0;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        logger.error(path + ": Cannot open file.");
+        return nullptr;
+    }
+    size = size_t(file.tellg());
+    std::shared_ptr<char> buffer = _allocate(size);
+    file.seekg(0);
+    if (!file.read(buffer.get(), std::streamsize(size))) {
+        logger.error(path + ": Cannot read file.");
+        return nullptr;
+    }
+    return buffer;
+}
+
+#endif
+
+bool writeFile(
+    const std::string& path,
+    const std::function<bool(std::FILE* file)>& write,
+    const Logger& logger
+) {
+    std::error_code ec;
+    const auto status = std::filesystem::status(path, ec);
+    const bool inPlace = std::filesystem::exists(status)
+                      && !std::filesystem::is_regular_file(status);
+    const std::string tempPath =
+        inPlace ? path
+                : path + ".tmp-" + std::to_string(std::random_device()());
+
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) {
+        logger.error(tempPath + ": Cannot open file: " + std::strerror(errno));
+        return false;
+    }
+    const bool written = write(file);
+    if (std::fclose(file) != 0 || !written) {
+        logger.error(tempPath + ": Cannot write file.");
+        if (!inPlace) std::remove(tempPath.c_str());
+        return false;
+    }
+    if (inPlace) return true;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        logger.error(path + ": Cannot replace file: " + ec.message());
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+Logger fileLogger(const std::string& path, const Logger& logger) {
+    const auto prefixed = [&path](const Logger::LogCallback& callback) {
+        if (!callback) return Logger::LogCallback();
+        return Logger::LogCallback(
+            [prefix = path + ": ", callback](const std::string& logStr) {
+                callback(prefix + logStr);
+            }
+        );
+    };
+    return Logger(
+        prefixed(logger.logErrorCallback),
+        prefixed(logger.logWarningCallback),
+        prefixed(logger.logInfoCallback)
+    );
+}
+
+}  // namespace c2p
@@ -0,0 +1,44 @@
+/**
+ * @file file_io.hpp
+ * @brief Reading whole files, memory mapped where possible.
+ */
+
+#ifndef __C2P_FILE_IO_HPP__
+#define __C2P_FILE_IO_HPP__
+
+#include <c2p/common.hpp>
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace c2p {
+
+/// Read-only contents of the file at `path`, aligned to 8 bytes.
+///
+/// The file is memory mapped on POSIX systems, and read into memory if it
+/// cannot be mapped. The contents stay valid while the pointer or a copy of
+/// it is alive. Return nullptr if the file cannot be read, `size` is set to
+/// the bytes of the file.
+std::shared_ptr<const char>
+mapFile(const std::string& path, size_t& size, const Logger& logger);
+
+/// Write the file at `path` with `write`, which returns false on failure.
+///
+/// A temporary file is written and renamed, so that concurrent readers see
+/// either the old or the new file. Existing files which are NOT regular, e.g.
+/// a pipe or a device, are written in place.
+bool writeFile(
+    const std::string& path,
+    const std::function<bool(std::FILE* file)>& write,
+    const Logger& logger
+);
+
+/// Logger which prefixes all messages to `logger` with `path`, the same as
+/// the errors of `mapFile`.
+Logger fileLogger(const std::string& path, const Logger& logger);
+
+}  // namespace c2p
+
+#endif  // __C2P_FILE_IO_HPP__
@@ -0,0 +1,314 @@
+#include "c2p/frozen_tree.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace c2p {
+
+/// Sections of a FrozenTree while it is built.
+struct _FrozenBuilder {
+    std::vector<frozen::Node> nodes;
+
+    /// Tables in 32-bit words.
+    std::vector<uint32_t> tables;
+
+    std::string strings;
+
+    /// Size of an entry of an object table in 32-bit words.
+    static constexpr size_t ENTRY_WORDS =
+        sizeof(frozen::Entry) / sizeof(uint32_t);
+
+    /// Offsets of strings in `strings`. Keys refer to the strings of the
+    /// source tree, which outlives the builder.
+    std::unordered_map<std::string_view, uint64_t> stringOffsets;
+
+    uint64_t addString(std::string_view str) {
+        const auto [it, inserted] =
+            stringOffsets.try_emplace(str, strings.size());
+        if (inserted) strings.append(str);
+        return it->second;
+    }
+
+    /// An array or object whose subtrees are being added.
+    struct _Frame {
+        const ArrayNode* array = nullptr;
+        /// Non-empty members of an object, sorted by key.
+        std::vector<std::pair<std::string_view, const ValueTree*>> entries;
+        /// Start of its table in `tables`.
+        size_t table = 0;
+        /// Next element or member to add.
+        size_t index = 0;
+    };
+
+    /// Add `tree` and its subtrees in depth-first order, with a stack of the
+    /// arrays and objects being added instead of recursion, so that trees of
+    /// any depth can be frozen. Return the index of its node.
+    uint32_t addNode(const ValueTree& tree) {
+        std::vector<_Frame> frames;
+        const uint32_t root = _openNode(tree, frames);
+        while (!frames.empty()) {
+            // `_openNode` may push a frame, so `frame` is NOT used after it.
+            auto& frame = frames.back();
+            const size_t table = frame.table;
+            const size_t idx = frame.index++;
+            if (frame.array) {
+                if (idx == frame.array->size()) {
+                    frames.pop_back();
+                    continue;
+                }
+                const uint32_t child = _openNode((*frame.array)[idx], frames);
+                tables[table + idx] = child;
+            } else {
+                if (idx == frame.entries.size()) {
+                    frames.pop_back();
+                    continue;
+                }
+                const auto [key, subTree] = frame.entries[idx];
+                frozen::Entry entry{};
+                entry.keyOffset = _checkedSize(addString(key));
+                entry.keySize = _checkedSize(key.size());
+                entry.node = _openNode(*subTree, frames);
+                std::memcpy(
+                    &tables[table + idx * ENTRY_WORDS], &entry, sizeof(entry)
+                );
+            }
+        }
+        return root;
+    }
+
+    /// Add the node of `tree`, and push a frame to add its subtrees if it is
+    /// an array or object. Return the index of its node.
+    uint32_t _openNode(const ValueTree& tree, std::vector<_Frame>& frames) {
+        const uint32_t index = _checkedSize(nodes.size());
+        nodes.emplace_back();
+        frozen::Node node{};
+        node.state = uint8_t(tree.state());
+
+        if (const auto value = tree.getValue()) {
+            node.typeTag = uint8_t(value->typeTag());
+            switch (value->typeTag()) {
+                case TypeTag::BOOL:
+                    node.payload = *value->value<TypeTag::BOOL>() ? 1 : 0;
+                    break;
+                case TypeTag::INTEGER:
+                    node.payload =
+                        uint64_t(*value->value<TypeTag::INTEGER>());
+                    break;
+                case TypeTag::NUMBER: {
+                    const double number = *value->value<TypeTag::NUMBER>();
+                    std::memcpy(&node.payload, &number, sizeof(number));
+                } break;
+                case TypeTag::STRING: {
+                    const auto str = *value->stringView();
+                    node.payload = addString(str);
+                    node.size = _checkedSize(str.size());
+                } break;
+                default: break;
+            }
+        } else if (const auto array = tree.getArray()) {
+            node.size = _checkedSize(array->size());
+            node.payload = tables.size() * sizeof(uint32_t);
+            // Nodes of the subtrees are added after the table is allocated,
+            // so that tables of subtrees do NOT overlap with it.
+            _Frame frame;
+            frame.array = array;
+            frame.table = tables.size();
+            tables.resize(frame.table + array->size());
+            frames.push_back(std::move(frame));
+        } else if (const auto object = tree.getObject()) {
+            _Frame frame;
+            auto& entries = frame.entries;
+            entries.reserve(object->size());
+            for (const auto& [key, subTree]: *object) {
+                if (subTree.isEmpty()) continue;
+                entries.emplace_back(key, &subTree);
+            }
+            const auto byKey = [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+            };
+            if (!std::is_sorted(entries.begin(), entries.end(), byKey)) {
+                std::sort(entries.begin(), entries.end(), byKey);
+            }
+            node.size = _checkedSize(entries.size());
+            node.payload = tables.size() * sizeof(uint32_t);
+            frame.table = tables.size();
+            tables.resize(frame.table + entries.size() * ENTRY_WORDS);
+            frames.push_back(std::move(frame));
+        }
+        nodes[index] = node;
+        return index;
+    }
+
+    static uint32_t _checkedSize(uint64_t size) {
+        if (size > std::numeric_limits<uint32_t>::max()) {
+            throw std::length_error("c2p::FrozenTree is too large");
+        }
+        return uint32_t(size);
+    }
+};
+
+FrozenTree::FrozenTree() {
+    frozen::Header header{};
+    header.size = sizeof(header);
+    header.tablesOffset = sizeof(header);
+    header.stringsOffset = sizeof(header);
+    const auto buffer = _allocate(sizeof(header));
+    std::memcpy(buffer.get(), &header, sizeof(header));
+    _data = buffer;
+}
+
+FrozenTree::FrozenTree(const ValueTree& tree) {
+    _FrozenBuilder builder;
+    if (!tree.isEmpty()) builder.addNode(tree);
+
+    frozen::Header header{};
+    header.nodeCount = uint32_t(builder.nodes.size());
+    header.tablesOffset =
+        sizeof(header) + builder.nodes.size() * sizeof(frozen::Node);
+    header.stringsOffset =
+        header.tablesOffset + builder.tables.size() * sizeof(uint32_t);
+    header.size = header.stringsOffset + builder.strings.size();
+
+    const auto buffer = _allocate(header.size);
+    char* data = buffer.get();
+    // Sections may be empty, whose data may be nullptr.
+    const auto copy = [data](size_t offset, const void* section, size_t size) {
+        if (size > 0) std::memcpy(data + offset, section, size);
+    };
+    copy(0, &header, sizeof(header));
+    copy(
+        sizeof(header),
+        builder.nodes.data(),
+        builder.nodes.size() * sizeof(frozen::Node)
+    );
+    copy(
+        header.tablesOffset,
+        builder.tables.data(),
+        builder.tables.size() * sizeof(uint32_t)
+    );
+    copy(header.stringsOffset, builder.strings.data(), builder.strings.size());
+    _data = buffer;
+}
+
+std::optional<FrozenTree> FrozenTree::constructFrom(
+    std::shared_ptr<const char> data,
+    size_t size,
+    const Logger& logger
+) {
+    if (!data || reinterpret_cast<uintptr_t>(data.get()) % alignof(uint64_t)) {
+        logger.error("FrozenTree: Buffer is NOT aligned to 8 bytes.");
+        return std::nullopt;
+    }
+    if (size < sizeof(frozen::Header)) {
+        logger.error("FrozenTree: Buffer is smaller than its header.");
+        return std::nullopt;
+    }
+    frozen::Header header;
+    std::memcpy(&header, data.get(), sizeof(header));
+    const uint64_t nodesEnd =
+        sizeof(header) + uint64_t(header.nodeCount) * sizeof(frozen::Node);
+    if (header.size != size || header.tablesOffset != nodesEnd
+        || header.stringsOffset < header.tablesOffset
+        || header.stringsOffset > header.size) {
+        logger.error("FrozenTree: Buffer has an invalid header.");
+        return std::nullopt;
+    }
+    return FrozenTree(std::move(data));
+}
+
+std::shared_ptr<char> FrozenTree::_allocate(size_t size) {
+    const size_t words = (size + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    const std::shared_ptr<uint64_t[]> buffer(new uint64_t[words]());
+    return std::shared_ptr<char>(buffer, reinterpret_cast<char*>(buffer.get()));
+}
+
+/// An array or object being thawed by `FrozenNode::thaw`.
+struct _ThawFrame {
+    /// Exactly one of `array` and `object` is set.
+    FrozenArray array;
+    FrozenObject object;
+
+    /// Next element to copy, into `toArray` whose elements are still empty.
+    size_t index = 0;
+    ArrayNode* toArray = nullptr;
+
+    /// Next member to copy, into `toIt` whose subtree is still empty.
+    FrozenObject::const_iterator fromIt{ nullptr, nullptr, 0 };
+    ObjectNode::iterator toIt;
+};
+
+ValueTree FrozenNode::thaw() const {
+    ValueTree tree;
+    std::vector<_ThawFrame> frames;
+    // Copy a value, or push a frame to copy the subtrees of an array or
+    // object, with a stack instead of recursion, so that trees of any depth
+    // can be thawed.
+    const auto open = [&frames](const FrozenNode& from, ValueTree& to) {
+        switch (from.state()) {
+            case ValueTree::State::VALUE: {
+                const auto node = *from.getValue();
+                if (const auto str = node.stringView()) {
+                    to = ValueNode(std::string(*str));
+                } else {
+                    to = node;
+                }
+            } break;
+            case ValueTree::State::ARRAY: {
+                _ThawFrame frame;
+                frame.array = from.getArray();
+                // Resized at once, so that elements stay in place while
+                // frames point to them.
+                frame.toArray = &to.asArray();
+                frame.toArray->resize(frame.array.size());
+                frames.push_back(frame);
+            } break;
+            case ValueTree::State::OBJECT: {
+                _ThawFrame frame;
+                frame.object = from.getObject();
+                // All members are inserted at once, since inserting may move
+                // the elements of a FlatMap.
+                auto& object = to.asObject();
+                for (const auto [key, subTree]: frame.object) {
+                    object.emplace_hint(
+                        object.end(), ObjectKey(key), ValueTree()
+                    );
+                }
+                frame.fromIt = frame.object.begin();
+                frame.toIt = object.begin();
+                frames.push_back(frame);
+            } break;
+            default: break;
+        }
+    };
+
+    open(*this, tree);
+    while (!frames.empty()) {
+        // `open` may push a frame, so `frame` is NOT used after it.
+        auto& frame = frames.back();
+        if (frame.array) {
+            if (frame.index == frame.array.size()) {
+                frames.pop_back();
+                continue;
+            }
+            const size_t idx = frame.index++;
+            open(frame.array[idx], (*frame.toArray)[idx]);
+        } else {
+            if (frame.fromIt == frame.object.end()) {
+                frames.pop_back();
+                continue;
+            }
+            const auto from = (*frame.fromIt).second;
+            ValueTree& to = frame.toIt->second;
+            ++frame.fromIt;
+            ++frame.toIt;
+            open(from, to);
+        }
+    }
+    return tree;
+}
+
+}  // namespace c2p
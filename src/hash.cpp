@@ -0,0 +1,183 @@
+#include "c2p/hash.hpp"
+
+#include "xxh64.hpp"
+
+#include <cstring>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace c2p {
+
+/// Mix bits of `x` (finalizer of SplitMix64), so that combined hashes do
+/// NOT cancel out.
+static uint64_t _mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/// XXH64 rather than std::hash, which differs between standard libraries.
+static uint64_t _hashString(std::string_view str) {
+    return xxh64(str.data(), str.size());
+}
+
+static uint64_t _hashValue(const ValueNode& node) {
+    const uint64_t tag = uint64_t(node.typeTag()) << 56;
+    switch (node.typeTag()) {
+        case TypeTag::BOOL:
+            return _mix(tag | uint64_t(*node.value<TypeTag::BOOL>()));
+        case TypeTag::NUMBER: {
+            // Equal numbers must have equal hashes, -0.0 == 0.0.
+            const double number = *node.value<TypeTag::NUMBER>() + 0.0;
+            uint64_t bits = 0;
+            std::memcpy(&bits, &number, sizeof(bits));
+            return _mix(tag ^ bits);
+        }
+        case TypeTag::STRING:
+            return _mix(tag ^ _hashString(*node.stringView()));
+        case TypeTag::INTEGER:
+            return _mix(tag ^ uint64_t(*node.value<TypeTag::INTEGER>()));
+        default: return _mix(tag);
+    }
+}
+
+/// An array or object being hashed by `_hashTree`.
+struct _HashFrame {
+    const ValueTree* tree;
+
+    /// Set for an array, with its next element and the number of non-empty
+    /// ones hashed.
+    const ArrayNode* array = nullptr;
+    size_t index = 0;
+    size_t count = 0;
+
+    /// Next member of an object, and the key of the one being hashed.
+    ObjectNode::const_iterator it;
+    ObjectNode::const_iterator end;
+    const ObjectKey* key = nullptr;
+
+    /// Hash of the elements so far, or sum of the hashes of the members.
+    uint64_t hash = 0;
+
+    /// Add the hash of the element or member being hashed.
+    void add(uint64_t subTreeHash) {
+        if (array) {
+            hash = _mix(hash ^ subTreeHash);
+            ++count;
+        } else {
+            // Sum of the hashes of the keys, so their order does NOT matter.
+            hash += _mix(_hashString(*key) ^ subTreeHash);
+        }
+    }
+};
+
+/// Hash `tree` from the hashes of its subtrees (a Merkle tree), with a stack
+/// of the arrays and objects being hashed instead of recursion, so that trees
+/// of any depth can be hashed. `cached(subTree)` gets the hash of an array or
+/// object if it is known, and `store(subTree, hash)` is called with each one
+/// computed.
+template <typename Cached, typename Store>
+static uint64_t
+_hashTree(const ValueTree& tree, const Cached& cached, const Store& store) {
+    std::vector<_HashFrame> frames;
+    // Hash a value, or push a frame to hash the subtrees of an array or
+    // object.
+    const auto open = [&](const ValueTree& subTree) -> std::optional<uint64_t> {
+        const auto state = subTree.state();
+        if (state == ValueTree::State::VALUE) {
+            return _hashValue(*subTree.getValue());
+        }
+        if (state == ValueTree::State::EMPTY) return _mix(uint64_t(state));
+        if (const auto hash = cached(subTree)) return hash;
+        auto& frame = frames.emplace_back();
+        frame.tree = &subTree;
+        if (state == ValueTree::State::OBJECT) {
+            frame.it = subTree.getObject()->begin();
+            frame.end = subTree.getObject()->end();
+        } else {
+            frame.array = subTree.getArray();
+        }
+        return std::nullopt;
+    };
+
+    if (const auto hash = open(tree)) return *hash;
+    while (true) {
+        // `open` may push a frame, so `frame` is NOT used after it.
+        auto& frame = frames.back();
+        // Empty subtrees count as absent, the same as `diff` and
+        // `json::dumpCanonical`.
+        bool isOpened = false;
+        if (frame.array) {
+            const auto& array = *frame.array;
+            while (!isOpened && frame.index < array.size()) {
+                const auto& element = array[frame.index++];
+                if (element.isEmpty()) continue;
+                const auto hash = open(element);
+                if (hash) frame.add(*hash);
+                else isOpened = true;
+            }
+        } else {
+            while (!isOpened && frame.it != frame.end) {
+                const auto& [key, member] = *frame.it++;
+                if (member.isEmpty()) continue;
+                frame.key = &key;
+                const auto hash = open(member);
+                if (hash) frame.add(*hash);
+                else isOpened = true;
+            }
+        }
+        if (isOpened) continue;
+
+        // All subtrees are hashed.
+        const uint64_t hash = frame.array
+            ? _mix(_mix(uint64_t(ValueTree::State::ARRAY) << 56 | frame.count)
+                   ^ frame.hash)
+            : _mix(uint64_t(ValueTree::State::OBJECT) << 56 ^ frame.hash);
+        store(*frame.tree, hash);
+        frames.pop_back();
+        if (frames.empty()) return hash;
+        frames.back().add(hash);
+    }
+}
+
+uint64_t hash(const ValueTree& tree) {
+    return _hashTree(
+        tree,
+        [](const ValueTree&) { return std::optional<uint64_t>(); },
+        [](const ValueTree&, uint64_t) {});
+}
+
+uint64_t SubtreeHashes::hash(const ValueTree& tree) {
+    // Hashes NOT used since the previous sweep are dropped, once the cache
+    // has grown to 4 times the size after it, so that hashing them again is
+    // paid for by the hashing since then.
+    if (_hashes.size() > 4 * _sweptSize) {
+        for (auto it = _hashes.begin(); it != _hashes.end();) {
+            if (it->second.epoch != _epoch) it = _hashes.erase(it);
+            else ++it;
+        }
+        ++_epoch;
+        _sweptSize = _hashes.size();
+    }
+    // Values are cheap to hash, only arrays and objects are cached.
+    return _hashTree(
+        tree,
+        [this](const ValueTree& subTree) -> std::optional<uint64_t> {
+            const auto it = _hashes.find(&subTree);
+            if (it == _hashes.end()
+                || it->second.generation != subTree.generation()) {
+                return std::nullopt;
+            }
+            it->second.epoch = _epoch;
+            return it->second.hash;
+        },
+        [this](const ValueTree& subTree, uint64_t hash) {
+            _hashes[&subTree] = { subTree.generation(), hash, _epoch };
+        });
+}
+
+}  // namespace c2p
@@ -1,6 +1,8 @@
 #include "c2p/ini.hpp"
 
+#include "file_io.hpp"
 #include "text_utils.hpp"
+#include "tree_reuse.hpp"
 
 #include <cassert>
 #include <sstream>
@@ -53,8 +55,14 @@ static void _skipWhitespaceInLine(const TextContext& ctx, PositionInText& pos) {
     while (_parseWhitespaceInLine(ctx, pos) || _parseCommentInLine(ctx, pos));
 }
 
-static std::optional<std::string> _parseQuotedString(
-    const TextContext& ctx, PositionInText& pos, const Logger& logger
+/// Parse a quoted string.
+/// Returns a view into the text if the string has no escapes, otherwise
+/// unescapes it into `buffer` and returns a view of `buffer`.
+static std::optional<std::string_view> _parseQuotedString(
+    std::string& buffer,
+    const TextContext& ctx,
+    PositionInText& pos,
+    const Logger& logger
 ) {
     assert(pos.valid);
     assert(ctx.text[pos.pos] == '"');
@@ -73,9 +81,14 @@ static std::optional<std::string> _parseQuotedString(
         return std::nullopt;
     }
 
-    std::string result;
+    const auto contentStartPos = pos;
+    bool escaped = false;
     while (ctx.text[pos.pos] != '"' && !ctx.atLineEnd(pos)) {
         if (ctx.text[pos.pos] == '\\') {
+            if (!escaped) {
+                buffer.assign(ctx.slice(contentStartPos, pos));
+                escaped = true;
+            }
             if (!ctx.moveForwardInLine(pos)) {
                 _logErrorAtPos(
                     logger,
@@ -86,14 +99,14 @@ static std::optional<std::string> _parseQuotedString(
                 return std::nullopt;
             }
             switch (ctx.text[pos.pos]) {
-                case '"': result.push_back('"'); break;
-                case '\\': result.push_back('\\'); break;
-                case '/': result.push_back('/'); break;
-                case 'b': result.push_back('\b'); break;
-                case 'f': result.push_back('\f'); break;
-                case 'n': result.push_back('\n'); break;
-                case 'r': result.push_back('\r'); break;
-                case 't': result.push_back('\t'); break;
+                case '"': buffer.push_back('"'); break;
+                case '\\': buffer.push_back('\\'); break;
+                case '/': buffer.push_back('/'); break;
+                case 'b': buffer.push_back('\b'); break;
+                case 'f': buffer.push_back('\f'); break;
+                case 'n': buffer.push_back('\n'); break;
+                case 'r': buffer.push_back('\r'); break;
+                case 't': buffer.push_back('\t'); break;
                 case 'u': {
                     auto aheadPos = pos;
                     for (int idx = 0; idx < 4; ++idx) {
@@ -119,7 +132,7 @@ static std::optional<std::string> _parseQuotedString(
                         }
                     }
                     ctx.moveForwardInLine(pos);
-                    result += unicodeToUtf8(uint32_t(
+                    buffer += unicodeToUtf8(uint32_t(
                         std::stoul(std::string(ctx.slice(pos, 4)), nullptr, 16)
                     ));
                     pos = aheadPos;
@@ -150,7 +163,7 @@ static std::optional<std::string> _parseQuotedString(
                         }
                     }
                     ctx.moveForwardInLine(pos);
-                    result += unicodeToUtf8(uint32_t(
+                    buffer += unicodeToUtf8(uint32_t(
                         std::stoul(std::string(ctx.slice(pos, 8)), nullptr, 16)
                     ));
                     pos = aheadPos;
@@ -163,8 +176,8 @@ static std::optional<std::string> _parseQuotedString(
                     return std::nullopt;
                 }
             }
-        } else {
-            result.push_back(ctx.text[pos.pos]);
+        } else if (escaped) {
+            buffer.push_back(ctx.text[pos.pos]);
         }
         ctx.moveForwardInLine(pos);
     }
@@ -179,12 +192,14 @@ static std::optional<std::string> _parseQuotedString(
         );
         return std::nullopt;
     }
+    const auto result =
+        escaped ? std::string_view(buffer) : ctx.slice(contentStartPos, pos);
     ctx.moveForwardInLine(pos);  // Skip closing quote
 
     return result;
 }
 
-static std::optional<std::string> _parseNoQuotedHeaderString(
+static std::optional<std::string_view> _parseNoQuotedHeaderString(
     const TextContext& ctx, PositionInText& pos, const Logger& logger
 ) {
     assert(pos.valid);
@@ -217,15 +232,13 @@ static std::optional<std::string> _parseNoQuotedHeaderString(
         ctx.moveForwardInLine(pos);
     }
 
-    const std::string result = std::string(ctx.slice(
+    return ctx.slice(
         startPos,
         whitespaceStartPos.pos == startPos.pos ? pos : whitespaceStartPos
-    ));
-
-    return result;
+    );
 }
 
-static std::optional<std::string> _parseNoQuotedKeyString(
+static std::optional<std::string_view> _parseNoQuotedKeyString(
     const TextContext& ctx, PositionInText& pos, const Logger& logger
 ) {
     assert(pos.valid);
@@ -263,13 +276,13 @@ static std::optional<std::string> _parseNoQuotedKeyString(
         return std::nullopt;
     }
 
-    return std::string(ctx.slice(
+    return ctx.slice(
         startPos,
         whitespaceStartPos.pos == startPos.pos ? pos : whitespaceStartPos
-    ));
+    );
 }
 
-static std::optional<std::string> _parseNoQuotedValueString(
+static std::optional<std::string_view> _parseNoQuotedValueString(
     const TextContext& ctx, PositionInText& pos, const Logger& logger
 ) {
     assert(pos.valid);
@@ -300,16 +313,19 @@ static std::optional<std::string> _parseNoQuotedValueString(
         }
     }
 
-    return std::string(ctx.slice(
+    return ctx.slice(
         startPos,
         (whitespaceStartPos.valid && whitespaceStartPos.pos == startPos.pos)
             ? pos
             : whitespaceStartPos
-    ));
+    );
 }
 
-static std::optional<std::string> _parseSectionHeader(
-    const TextContext& ctx, PositionInText& pos, const Logger& logger
+static std::optional<std::string_view> _parseSectionHeader(
+    std::string& buffer,
+    const TextContext& ctx,
+    PositionInText& pos,
+    const Logger& logger
 ) {
     assert(pos.valid);
     assert(ctx.text[pos.pos] == '[');
@@ -339,9 +355,9 @@ static std::optional<std::string> _parseSectionHeader(
         return std::nullopt;
     }
 
-    std::optional<std::string> header;
+    std::optional<std::string_view> header;
     if (ctx.text[pos.pos] == '"') {
-        header = _parseQuotedString(ctx, pos, logger);
+        header = _parseQuotedString(buffer, ctx, pos, logger);
         if (!header) {
             _logErrorAtPos(
                 logger, ctx, leftBracketPos, "Failed to parse section header."
@@ -383,15 +399,23 @@ static std::optional<std::string> _parseSectionHeader(
     return header;
 }
 
-static std::optional<std::pair<std::string, std::string>>
-_parseEntry(const TextContext& ctx, PositionInText& pos, const Logger& logger) {
+/// Parse a key-value entry.
+/// Returns views into the text, or into `keyBuffer` and `valueBuffer` for
+/// quoted strings with escapes.
+static std::optional<std::pair<std::string_view, std::string_view>> _parseEntry(
+    std::string& keyBuffer,
+    std::string& valueBuffer,
+    const TextContext& ctx,
+    PositionInText& pos,
+    const Logger& logger
+) {
     assert(pos.valid);
     assert(!std::isspace(uint8_t(ctx.text[pos.pos])));
 
     const auto keyStartPos = pos;
-    std::optional<std::string> key;
+    std::optional<std::string_view> key;
     if (ctx.text[pos.pos] == '"') {
-        key = _parseQuotedString(ctx, pos, logger);
+        key = _parseQuotedString(keyBuffer, ctx, pos, logger);
         if (!key) {
             _logErrorAtPos(logger, ctx, keyStartPos, "Failed to parse key.");
             return std::nullopt;
@@ -418,18 +442,18 @@ _parseEntry(const TextContext& ctx, PositionInText& pos, const Logger& logger) {
     // Skip equal sign
     if (!ctx.moveForwardInLine(pos)) {
         // Empty value
-        return std::make_pair(*key, std::string(""));
+        return std::make_pair(*key, std::string_view());
     }
 
     _skipWhitespaceInLine(ctx, pos);
     if (ctx.atLineEnd(pos) && std::isspace(uint8_t(ctx.text[pos.pos]))) {
         // Empty value
-        return std::make_pair(*key, std::string(""));
+        return std::make_pair(*key, std::string_view());
     }
     const auto valueStartPos = pos;
-    std::optional<std::string> value;
+    std::optional<std::string_view> value;
     if (ctx.text[pos.pos] == '"') {
-        value = _parseQuotedString(ctx, pos, logger);
+        value = _parseQuotedString(valueBuffer, ctx, pos, logger);
         if (!value) {
             _logErrorAtPos(
                 logger, ctx, valueStartPos, "Failed to parse value."
@@ -449,10 +473,22 @@ _parseEntry(const TextContext& ctx, PositionInText& pos, const Logger& logger) {
     return std::make_pair(*key, *value);
 }
 
-ValueTree parse(const std::string& ini, const Logger& logger) {
+/// Result of `_parse`.
+enum class _ParseStatus {
+    ERROR,    ///< The input is invalid, which is logged.
+    STOPPED,  ///< An event returned false.
+    DONE,
+};
+
+/// Parse a whole INI string into `events`, which has `section(name)` and
+/// `entry(key, value, valueBuffer)`, each returning whether to continue. The
+/// value is in `valueBuffer` iff it has escapes.
+template <typename Events>
+static _ParseStatus
+_parse(std::string_view ini, Events& events, const Logger& logger) {
     if (ini.empty()) {
         logger.error("Empty INI.");
-        return ValueTree();
+        return _ParseStatus::ERROR;
     }
 
     TextContext ctx = { ini };
@@ -460,8 +496,9 @@ ValueTree parse(const std::string& ini, const Logger& logger) {
         .valid = true, .pos = 0, .lineIdx = 0, .linePos = 0
     };
 
-    ValueTree tree;
-    ValueTree* section = &tree;
+    std::string keyBuffer;
+    std::string valueBuffer;
+
     do {
 
 #if false
@@ -480,31 +517,235 @@ ValueTree parse(const std::string& ini, const Logger& logger) {
 
         const auto lineStartPos = pos;
         if (ctx.text[pos.pos] == '[') {
-            auto header = _parseSectionHeader(ctx, pos, logger);
+            auto header = _parseSectionHeader(keyBuffer, ctx, pos, logger);
             if (!header) {
                 logger.error(
                     lineStartPos.toString() + ": Failed to parse section."
                 );
-                return ValueTree();
+                return _ParseStatus::ERROR;
             }
-            section = &(tree[*header]);
-            section->asObject();
+            if (!events.section(*header)) return _ParseStatus::STOPPED;
         } else {
-            auto entry = _parseEntry(ctx, pos, logger);
+            auto entry =
+                _parseEntry(keyBuffer, valueBuffer, ctx, pos, logger);
             if (!entry) {
                 logger.error(
                     lineStartPos.toString() + ": Failed to parse entry."
                 );
-                return ValueTree();
+                return _ParseStatus::ERROR;
+            }
+            if (!events.entry(entry->first, entry->second, valueBuffer)) {
+                return _ParseStatus::STOPPED;
             }
-            (*section)[entry->first] = entry->second;
         }
     } while (ctx.moveToNextLine(pos));
 
+    return _ParseStatus::DONE;
+}
+
+/// Builds a ValueTree from the events of `_parse`.
+class _TreeBuilder
+{
+  public:
+
+    _TreeBuilder(ValueTree& tree, const ParseOptions& options)
+        : _tree(tree),
+          _section(&tree),
+          _resource(
+              options.resource ? options.resource
+                               : std::pmr::get_default_resource()
+          ),
+          _viewStrings(options.viewStrings) {}
+
+    bool section(std::string_view name) {
+        _section = &(_tree.asObject(_resource)[ObjectKey(name)]);
+        _section->asObject(_resource);
+        return true;
+    }
+
+    bool entry(
+        std::string_view key,
+        std::string_view value,
+        const std::string& valueBuffer
+    ) {
+        auto& node = _section->asObject(_resource)[ObjectKey(key)];
+        if (_viewStrings && value.data() != valueBuffer.data()) {
+            node = ValueNode::view(value);
+        } else {
+            node = value;
+        }
+        return true;
+    }
+
+  private:
+    ValueTree& _tree;
+    ValueTree* _section;
+    MemoryResource* _resource;
+    bool _viewStrings;
+};
+
+/// Builds a ValueTree from the events of `_parse` into an existing tree,
+/// reusing its sections and values where the shape matches, see `parseInto`.
+/// The result is the same as of `_TreeBuilder` into an empty tree.
+class _ReusingBuilder
+{
+  public:
+
+    _ReusingBuilder(ValueTree& tree, const ParseOptions& options)
+        : _tree(tree),
+          _section(&tree),
+          _resource(
+              options.resource ? options.resource
+                               : std::pmr::get_default_resource()
+          ),
+          _viewStrings(options.viewStrings),
+          _rootSpare(_resource),
+          _sectionSpare(_resource),
+          _spare(&_rootSpare) {
+        if (tree.isObject() && isReusable(tree, _resource)) {
+            detachMembers(*tree.getObject(), _rootSpare);
+        } else {
+            tree.clear();
+        }
+    }
+
+    bool section(std::string_view name) {
+        // Entries of the last section which are NOT reused are dropped.
+        _sectionSpare.clear();
+        _spare = &_sectionSpare;
+        auto& root = _tree.asObject(_resource);
+        const auto it = root.find(name);
+        if (it != root.end()) {
+            // A repeated section, whose entries are merged.
+            _section = &it->second;
+            _section->asObject(_resource);
+            _spare = nullptr;
+        } else if (auto section = takeMember(_rootSpare, name, root)) {
+            _section = section;
+            if (section->isObject() && isReusable(*section, _resource)) {
+                detachMembers(*section->getObject(), _sectionSpare);
+            } else {
+                section->clear();
+                section->asObject(_resource);
+            }
+        } else {
+            _section = &root[ObjectKey(name)];
+            _section->asObject(_resource);
+        }
+        return true;
+    }
+
+    bool entry(
+        std::string_view key,
+        std::string_view value,
+        const std::string& valueBuffer
+    ) {
+        auto& object = _section->asObject(_resource);
+        const auto it = object.find(key);
+        ValueTree* node = it != object.end() ? &it->second : nullptr;
+        if (!node && _spare) node = takeMember(*_spare, key, object);
+        if (!node) node = &object[ObjectKey(key)];
+        if (_viewStrings && value.data() != valueBuffer.data()) {
+            *node = ValueNode::view(value);
+        } else if (node->isValue() && !node->isShared()) {
+            node->asValue().setString(value);
+        } else {
+            *node = value;
+        }
+        return true;
+    }
+
+  private:
+    ValueTree& _tree;
+    ValueTree* _section;
+    MemoryResource* _resource;
+    bool _viewStrings;
+    /// Old members of the root, and old entries of the current section,
+    /// which are NOT reached yet.
+    ObjectNode _rootSpare;
+    ObjectNode _sectionSpare;
+    /// Spare of `_section`, or nullptr for a repeated section.
+    ObjectNode* _spare;
+};
+
+/// Passes the events of `_parse` to a `Handler`.
+struct _HandlerEvents {
+    Handler& handler;
+
+    bool section(std::string_view name) { return handler.section(name); }
+
+    bool entry(
+        std::string_view key, std::string_view value, const std::string&
+    ) {
+        return handler.entry(key, value);
+    }
+};
+
+ValueTree parse(const std::string& ini, const Logger& logger) {
+    return parse(ini, ParseOptions(), logger);
+}
+
+ValueTree parse(
+    const std::string& ini, MemoryResource* resource, const Logger& logger
+) {
+    return parse(ini, ParseOptions{ .resource = resource }, logger);
+}
+
+/// Parse `ini` into ValueTree, see `parse`.
+static ValueTree _parseTree(
+    std::string_view ini, const ParseOptions& options, const Logger& logger
+) {
+    ValueTree tree;
+    _TreeBuilder builder(tree, options);
+    if (_parse(ini, builder, logger) != _ParseStatus::DONE) {
+        return ValueTree();
+    }
     return tree;
 }
 
-static void _dumpString(const std::string& str, std::stringstream& stream) {
+ValueTree parse(
+    const std::string& ini, const ParseOptions& options, const Logger& logger
+) {
+    return _parseTree(ini, options, logger);
+}
+
+bool parseInto(
+    ValueTree& tree,
+    const std::string& ini,
+    const ParseOptions& options,
+    const Logger& logger
+) {
+    _ReusingBuilder builder(tree, options);
+    if (_parse(ini, builder, logger) != _ParseStatus::DONE) {
+        tree.clear();
+        return false;
+    }
+    // Without entries, the tree is empty as from `parse`.
+    if (tree.isObject() && tree.getObject()->empty()) tree.clear();
+    return true;
+}
+
+ValueTree parseFile(
+    const std::string& path, const ParseOptions& options, const Logger& logger
+) {
+    size_t size = 0;
+    const auto data = mapFile(path, size, logger);
+    if (!data) return ValueTree();
+
+    // Values are copied out of the mapping, which is unmapped on return.
+    ParseOptions fileOptions = options;
+    fileOptions.viewStrings = false;
+    return _parseTree(
+        std::string_view(data.get(), size), fileOptions, fileLogger(path, logger)
+    );
+}
+
+bool parse(const std::string& ini, Handler& handler, const Logger& logger) {
+    _HandlerEvents events = { handler };
+    return _parse(ini, events, logger) == _ParseStatus::DONE;
+}
+
+static void _dumpString(std::string_view str, std::stringstream& stream) {
     if (str.empty()) {
         stream << "\"\"";
         return;
@@ -560,7 +801,7 @@ static void _dumpString(const std::string& str, std::stringstream& stream) {
 }
 
 static void
-_dumpSectionHeader(const std::string& header, std::stringstream& stream) {
+_dumpSectionHeader(std::string_view header, std::stringstream& stream) {
     stream << '[';
     _dumpString(header, stream);
     stream << "]\n";
@@ -584,8 +825,12 @@ static void _dumpEntry(
             stream << *node.value<TypeTag::NUMBER>();
         } break;
 
+        case TypeTag::INTEGER: {
+            stream << *node.value<TypeTag::INTEGER>();
+        } break;
+
         case TypeTag::STRING: {
-            _dumpString(*node.value<TypeTag::STRING>(), stream);
+            _dumpString(*node.stringView(), stream);
         } break;
     }
     stream << '\n';
@@ -598,14 +843,14 @@ std::string dump(const ValueTree& tree) {
     std::stringstream stream;
 
     const auto& object = *tree.getObject();
-    std::map<std::string, const ObjectNode*> sections;
+    std::vector<std::pair<std::string_view, const ObjectNode*>> sections;
 
     // dump global entries & collect sections
     for (const auto& [key, value]: object) {
         if (value.isEmpty()) continue;
         if (value.isArray()) return "";  // INI does not support array
         if (value.isObject()) {
-            sections[key] = value.getObject();
+            sections.emplace_back(key, value.getObject());
             continue;
         }
         assert(value.isValue());
@@ -626,5 +871,22 @@ std::string dump(const ValueTree& tree) {
     return stream.str();
 }
 
+bool dumpFile(
+    const ValueTree& tree, const std::string& path, const Logger& logger
+) {
+    const std::string ini = dump(tree);
+    if (ini.empty() && !tree.isEmpty()) {
+        logger.error(path + ": Cannot convert the tree into INI.");
+        return false;
+    }
+    return writeFile(
+        path,
+        [&](std::FILE* file) {
+            return std::fwrite(ini.data(), 1, ini.size(), file) == ini.size();
+        },
+        logger
+    );
+}
+
 }  // namespace ini
 }  // namespace c2p
@@ -0,0 +1,36 @@
+#include "c2p/interned_key.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace c2p {
+
+const InternedKey::Entry* InternedKey::_intern(std::string_view str) {
+    const size_t hash = std::hash<std::string_view>()(str);
+
+    // Direct-mapped cache of this thread, hit by most repeated keys.
+    constexpr size_t CACHE_SIZE = 4096;
+    thread_local std::array<const Entry*, CACHE_SIZE> cache{};
+    const Entry*& cached = cache[hash & (CACHE_SIZE - 1)];
+    if (cached && cached->hash == hash && cached->str == str) return cached;
+
+    // Entries are never freed, even at exit, so keys stay valid in static
+    // trees. Their strings are the keys of the pool.
+    static std::mutex& mutex = *new std::mutex;
+    static auto& pool =
+        *new std::unordered_map<std::string_view, std::unique_ptr<Entry>>;
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = pool.find(str);
+    if (it != pool.end()) {
+        cached = it->second.get();
+        return cached;
+    }
+    auto entry = std::make_unique<Entry>(Entry{ std::string(str), hash });
+    cached = entry.get();
+    pool.emplace(cached->str, std::move(entry));
+    return cached;
+}
+
+}  // namespace c2p
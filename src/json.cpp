@@ -38,22 +38,32 @@
 
 #include "c2p/json.hpp"
 
+#include "file_io.hpp"
+#include "text_scan.hpp"
 #include "text_utils.hpp"
+#include "tree_reuse.hpp"
 
+#include <algorithm>
 #include <cassert>
-#include <sstream>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <type_traits>
 
 namespace c2p {
 namespace json {
 
 static void _logErrorAtPos(
     const Logger& logger,
-    const TextContext& ctx,
-    const PositionInText& pos,
+    const RawTextContext& ctx,
+    const char* pos,
     const std::string& msg
 ) {
+    const auto position = ctx.locate(pos);
     logger.error(
-        pos.toString() + ": " + msg +
+        ctx.inWholeText(position).toString() + ": " + msg +
         [](const std::vector<std::string>& msgLines) {
             std::string msg;
             for (const auto& msgLine: msgLines) {
@@ -61,47 +71,47 @@ static void _logErrorAtPos(
             }
             msg += "\n";
             return msg;
-        }(getPositionMessage(ctx, pos))
+        }(getPositionMessage(ctx, position))
     );
 }
 
-static bool _parseWhitespace(const TextContext& ctx, PositionInText& pos) {
-    if (!pos.valid || !std::isspace(uint8_t(ctx.text[pos.pos]))) {
+static bool _parseWhitespace(const RawTextContext& ctx, const char*& pos) {
+    if (pos == ctx.end || !std::isspace(uint8_t(*pos))) {
         return false;
     }
-    ctx.moveForward(pos);
+    pos = scanWhitespace(pos, ctx.end);
     return true;
 }
 
-static bool _parseComment(const TextContext& ctx, PositionInText& pos) {
-    auto aheadPos = pos;
-    if (!ctx.moveForward(aheadPos)   //
-        || ctx.text[pos.pos] != '/'  //
-        || ctx.text[aheadPos.pos] != '/')
-    {
+static bool _parseComment(const RawTextContext& ctx, const char*& pos) {
+    if (ctx.end - pos < 2 || pos[0] != '/' || pos[1] != '/') {
         return false;
     }
-    ctx.moveToNextLine(pos);
+    pos = scanLineChars(pos, ctx.end);
+    pos = ctx.nextLine(pos);
     return true;
 }
 
-static void _skipWhitespace(const TextContext& ctx, PositionInText& pos) {
+static void _skipWhitespace(const RawTextContext& ctx, const char*& pos) {
     while (_parseWhitespace(ctx, pos) || _parseComment(ctx, pos));
 }
 
-static bool _parseString(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
+/// Parse a quoted string.
+/// Returns a view into the text if the string has no escapes, otherwise
+/// unescapes it into `buffer` and returns a view of `buffer`.
+static std::optional<std::string_view> _parseStringContent(
+    std::string& buffer,
+    const RawTextContext& ctx,
+    const char*& pos,
     const Logger& logger
 ) {
-    assert(pos.valid);
-    assert(ctx.text[pos.pos] == '"');
+    assert(pos < ctx.end);
+    assert(*pos == '"');
 
     const auto leftQuotePos = pos;
 
     // Skip initial quote
-    if (!ctx.moveForwardInLine(pos)) {
+    if (ctx.atLineEnd(pos)) {
         _logErrorAtPos(
             logger,
             ctx,
@@ -109,526 +119,2066 @@ static bool _parseString(
             "Unterminated quoted string. "
             "Expected closing quote '\"' in same line."
         );
-        return false;
-    }
-
-    std::string result;
-    while (ctx.text[pos.pos] != '"' && !ctx.atLineEnd(pos)) {
-        if (ctx.text[pos.pos] == '\\') {
-            if (!ctx.moveForwardInLine(pos)) {
-                _logErrorAtPos(
-                    logger,
-                    ctx,
-                    pos,
-                    "Unexpected end of input in string escape."
-                );
-                return false;
-            }
-            switch (ctx.text[pos.pos]) {
-                case '"': result.push_back('"'); break;
-                case '\\': result.push_back('\\'); break;
-                case '/': result.push_back('/'); break;
-                case 'b': result.push_back('\b'); break;
-                case 'f': result.push_back('\f'); break;
-                case 'n': result.push_back('\n'); break;
-                case 'r': result.push_back('\r'); break;
-                case 't': result.push_back('\t'); break;
-                case 'u': {
-                    auto aheadPos = pos;
-                    for (int idx = 0; idx < 4; ++idx) {
-                        if (!ctx.moveForwardInLine(aheadPos)) {
-                            _logErrorAtPos(
-                                logger,
-                                ctx,
-                                pos,
-                                "Unexpected end of input in Unicode escape. "
-                                "Need 4 Hex digits like: \"\\uHHHH\"."
-                            );
-                            return false;
-                        }
-                        if (!std::isxdigit(ctx.text[aheadPos.pos])) {
-                            _logErrorAtPos(
-                                logger,
-                                ctx,
-                                aheadPos,
-                                "Invalid Unicode escape character. "
-                                "Need 4 Hex digits like: \"\\uHHHH\"."
-                            );
-                            return false;
-                        }
-                    }
-                    ctx.moveForwardInLine(pos);
-                    result += unicodeToUtf8(uint32_t(
-                        std::stoul(std::string(ctx.slice(pos, 4)), nullptr, 16)
-                    ));
-                    pos = aheadPos;
-                    break;
-                }
-                case 'U': {
-                    auto aheadPos = pos;
-                    for (int idx = 0; idx < 8; ++idx) {
-                        if (!ctx.moveForwardInLine(aheadPos)) {
-                            _logErrorAtPos(
-                                logger,
-                                ctx,
-                                pos,
-                                "Unexpected end of input in Unicode escape. "
-                                "Need 8 Hex digits like: \"\\UHHHHHHHH\"."
-                            );
-                            return false;
-                        }
-                        if (!std::isxdigit(ctx.text[aheadPos.pos])) {
-                            _logErrorAtPos(
-                                logger,
-                                ctx,
-                                aheadPos,
-                                "Invalid Unicode escape character. "
-                                "Need 8 Hex digits like: \"\\UHHHHHHHH\"."
-                            );
-                            return false;
-                        }
-                    }
-                    ctx.moveForwardInLine(pos);
-                    result += unicodeToUtf8(uint32_t(
-                        std::stoul(std::string(ctx.slice(pos, 8)), nullptr, 16)
-                    ));
-                    pos = aheadPos;
-                    break;
-                }
-                default: {
-                    _logErrorAtPos(
-                        logger, ctx, pos, "Invalid escape character."
-                    );
-                    return false;
-                }
-            }
-        } else {
-            result.push_back(ctx.text[pos.pos]);
-        }
-        ctx.moveForwardInLine(pos);
-    }
-    if (ctx.text[pos.pos] != '"') {
-        _logErrorAtPos(
-            logger,
-            ctx,
-            pos,
-            "Unterminated string. "
-            "Expected closing quote '\"' in same line."
-        );
-        return false;
+        return std::nullopt;
     }
-    ctx.moveForward(pos);  // Skip closing quote
+    ++pos;
 
-    tree = result;
-    return true;
-}
-
-static bool _parseValue(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
-    const Logger& logger
-);
-
-static bool _parseObject(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
-    const Logger& logger
-) {
-    assert(pos.valid);
-    assert(ctx.text[pos.pos] == '{');
-    auto& object = tree.asObject();
-    ctx.moveForward(pos);  // Skip initial brace
-    _skipWhitespace(ctx, pos);
-    if (pos.valid && ctx.text[pos.pos] == '}') {
-        // Empty object
-        ctx.moveForward(pos);
-        return true;
-    }
-    while (pos.valid) {
-        _skipWhitespace(ctx, pos);
-        if (ctx.text[pos.pos] != '"') {
+    const auto contentStartPos = pos;
+    bool escaped = false;
+    while (true) {
+        // Copy the run of plain characters at once.
+        const auto runEndPos = scanStringChars(pos, ctx.end);
+        if (escaped) buffer.append(pos, runEndPos);
+        pos = runEndPos;
+        if (pos < ctx.end && *pos == '"') break;
+        if (pos == ctx.end || *pos != '\\' || ctx.atLineEnd(pos)) {
+            // Line break, end of input, or '\\' at the end of input.
+            if (pos < ctx.end && !ctx.atLineEnd(pos)) ++pos;  // "\r\n"
             _logErrorAtPos(
                 logger,
                 ctx,
                 pos,
-                "Expected quoted string with '\"' as object key."
-            );
-            return false;
-        }
-        const auto keyStartPos = pos;
-        ValueTree key;
-        if (!_parseString(key, ctx, pos, logger)) {
-            _logErrorAtPos(
-                logger, ctx, keyStartPos, "Failed to parse object key."
-            );
-            return false;
-        }
-        _skipWhitespace(ctx, pos);
-        if (!pos.valid || ctx.text[pos.pos] != ':') {
-            _logErrorAtPos(logger, ctx, pos, "Expected ':' in object.");
-            return false;
-        }
-        ctx.moveForward(pos);
-        _skipWhitespace(ctx, pos);
-        const auto valueStartPos = pos;
-        ValueTree& value = object[*key.value<TypeTag::STRING>()];
-        if (!_parseValue(value, ctx, pos, logger)) {
-            _logErrorAtPos(
-                logger, ctx, valueStartPos, "Failed to parse object value."
+                "Unterminated string. "
+                "Expected closing quote '\"' in same line."
             );
-            return false;
-        }
-        const auto afterValuePos = pos;
-        _skipWhitespace(ctx, pos);
-        if (pos.valid && ctx.text[pos.pos] == '}') {
-            ctx.moveForward(pos);
-            return true;
+            return std::nullopt;
         }
-        if (!pos.valid || ctx.text[pos.pos] != ',') {
-            _logErrorAtPos(
-                logger,
-                ctx,
-                afterValuePos,
-                "Expected ',' or '}' at the end of object."
-            );
-            return false;
+        if (!escaped) {
+            buffer.assign(contentStartPos, pos);
+            escaped = true;
         }
-        ctx.moveForward(pos);
-        _skipWhitespace(ctx, pos);
-        if (pos.valid && ctx.text[pos.pos] == '}') {
-            ctx.moveForward(pos);
-            return true;
+        ++pos;  // Skip '\\'
+        switch (*pos) {
+            case '"': buffer.push_back('"'); break;
+            case '\\': buffer.push_back('\\'); break;
+            case '/': buffer.push_back('/'); break;
+            case 'b': buffer.push_back('\b'); break;
+            case 'f': buffer.push_back('\f'); break;
+            case 'n': buffer.push_back('\n'); break;
+            case 'r': buffer.push_back('\r'); break;
+            case 't': buffer.push_back('\t'); break;
+            case 'u': {
+                auto aheadPos = pos;
+                for (int idx = 0; idx < 4; ++idx) {
+                    if (ctx.atLineEnd(aheadPos)) {
+                        _logErrorAtPos(
+                            logger,
+                            ctx,
+                            pos,
+                            "Unexpected end of input in Unicode escape. "
+                            "Need 4 Hex digits like: \"\\uHHHH\"."
+                        );
+                        return std::nullopt;
+                    }
+                    ++aheadPos;
+                    if (!std::isxdigit(uint8_t(*aheadPos))) {
+                        _logErrorAtPos(
+                            logger,
+                            ctx,
+                            aheadPos,
+                            "Invalid Unicode escape character. "
+                            "Need 4 Hex digits like: \"\\uHHHH\"."
+                        );
+                        return std::nullopt;
+                    }
+                }
+                buffer += unicodeToUtf8(uint32_t(
+                    std::stoul(std::string(pos + 1, 4), nullptr, 16)
+                ));
+                pos = aheadPos;
+                break;
+            }
+            case 'U': {
+                auto aheadPos = pos;
+                for (int idx = 0; idx < 8; ++idx) {
+                    if (ctx.atLineEnd(aheadPos)) {
+                        _logErrorAtPos(
+                            logger,
+                            ctx,
+                            pos,
+                            "Unexpected end of input in Unicode escape. "
+                            "Need 8 Hex digits like: \"\\UHHHHHHHH\"."
+                        );
+                        return std::nullopt;
+                    }
+                    ++aheadPos;
+                    if (!std::isxdigit(uint8_t(*aheadPos))) {
+                        _logErrorAtPos(
+                            logger,
+                            ctx,
+                            aheadPos,
+                            "Invalid Unicode escape character. "
+                            "Need 8 Hex digits like: \"\\UHHHHHHHH\"."
+                        );
+                        return std::nullopt;
+                    }
+                }
+                buffer += unicodeToUtf8(uint32_t(
+                    std::stoul(std::string(pos + 1, 8), nullptr, 16)
+                ));
+                pos = aheadPos;
+                break;
+            }
+            default: {
+                _logErrorAtPos(logger, ctx, pos, "Invalid escape character.");
+                return std::nullopt;
+            }
         }
+        ++pos;  // Skip the last character of escape
     }
-    _logErrorAtPos(logger, ctx, pos, "Unterminated object.");
-    return false;
+    const auto result = escaped
+                          ? std::string_view(buffer)
+                          : std::string_view(
+                                contentStartPos, pos - contentStartPos
+                            );
+    ++pos;  // Skip closing quote
+
+    return result;
 }
 
-static bool _parseArray(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
-    const Logger& logger
-) {
-    assert(pos.valid);
-    assert(ctx.text[pos.pos] == '[');
-    auto& array = tree.asArray();
-    ctx.moveForward(pos);  // Skip initial bracket
-    _skipWhitespace(ctx, pos);
-    if (pos.valid && ctx.text[pos.pos] == ']') {
-        ctx.moveForward(pos);
-        return true;
-    }
-    while (pos.valid) {
-        _skipWhitespace(ctx, pos);
-        const auto valueStartPos = pos;
-        array.push_back(ValueTree());
-        if (!_parseValue(array.back(), ctx, pos, logger)) {
-            _logErrorAtPos(
-                logger, ctx, valueStartPos, "Failed to parse array value."
-            );
-            return false;
-        }
-        _skipWhitespace(ctx, pos);
-        if (pos.valid && ctx.text[pos.pos] == ']') {
-            ctx.moveForward(pos);
-            return true;
-        }
-        if (!pos.valid || ctx.text[pos.pos] != ',') {
-            _logErrorAtPos(logger, ctx, pos, "Expected ',' or ']' in array.");
-            return false;
-        }
-        ctx.moveForward(pos);
-        _skipWhitespace(ctx, pos);
-        if (pos.valid && ctx.text[pos.pos] == ']') {
-            ctx.moveForward(pos);
-            return true;
-        }
-    }
-    _logErrorAtPos(logger, ctx, pos, "Unterminated array.");
-    return false;
+static bool _isDigit(const RawTextContext& ctx, const char* pos) {
+    return pos < ctx.end && std::isdigit(uint8_t(*pos));
 }
 
 static bool _parseNumber(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
+    ValueNode& node,
+    const RawTextContext& ctx,
+    const char*& pos,
     const Logger& logger
 ) {
-    assert(pos.valid);
+    assert(pos < ctx.end);
     const auto startPos = pos;
-    if (ctx.text[pos.pos] == '+' || ctx.text[pos.pos] == '-') {
-        ctx.moveForward(pos);
+    bool isInteger = true;
+    if (*pos == '+' || *pos == '-') {
+        ++pos;
     }
-    if (!pos.valid) {
+    if (pos == ctx.end) {
         _logErrorAtPos(logger, ctx, pos, "Invalid number.");
         return false;
     }
-    if (ctx.text[pos.pos] == '0') {
-        ctx.moveForward(pos);
+    if (*pos == '0') {
+        // -0 is NOT an integer, so it stays NUMBER -0.0.
+        if (*startPos == '-') isInteger = false;
+        ++pos;
     } else {
-        if (!std::isdigit(ctx.text[pos.pos])) {
+        if (!_isDigit(ctx, pos)) {
             _logErrorAtPos(logger, ctx, pos, "Invalid number.");
             return false;
         }
-        while (pos.valid && std::isdigit(ctx.text[pos.pos])) {
-            ctx.moveForward(pos);
-        }
+        while (_isDigit(ctx, pos)) ++pos;
     }
-    if (pos.valid && ctx.text[pos.pos] == '.') {
-        ctx.moveForward(pos);
-        if (!pos.valid || !std::isdigit(ctx.text[pos.pos])) {
+    if (pos < ctx.end && *pos == '.') {
+        ++pos;
+        isInteger = false;
+        if (!_isDigit(ctx, pos)) {
             _logErrorAtPos(logger, ctx, pos, "Invalid number.");
             return false;
         }
-        while (pos.valid && std::isdigit(ctx.text[pos.pos]))
-            ctx.moveForward(pos);
+        while (_isDigit(ctx, pos)) ++pos;
     }
-    if (pos.valid && (ctx.text[pos.pos] == 'e' || ctx.text[pos.pos] == 'E')) {
-        if (ctx.moveForward(pos)
-            && (ctx.text[pos.pos] == '+' || ctx.text[pos.pos] == '-'))
-        {
-            ctx.moveForward(pos);
+    if (pos < ctx.end && (*pos == 'e' || *pos == 'E')) {
+        ++pos;
+        isInteger = false;
+        if (pos < ctx.end && (*pos == '+' || *pos == '-')) {
+            ++pos;
         }
-        if (!pos.valid || !std::isdigit(ctx.text[pos.pos])) {
+        if (!_isDigit(ctx, pos)) {
             _logErrorAtPos(logger, ctx, pos, "Invalid number.");
             return false;
         }
-        while (pos.valid && std::isdigit(ctx.text[pos.pos])) {
-            ctx.moveForward(pos);
+        while (_isDigit(ctx, pos)) ++pos;
+    }
+    const std::string_view text(startPos, pos - startPos);
+    if (isInteger) {
+        if (const auto integer = toInteger(text)) {
+            node = *integer;
+            return true;
         }
+        // Integers beyond int64 fall back to double.
     }
-    tree = std::stod(std::string(ctx.slice(startPos, pos)));
-    return true;
-}
-
-static bool _parseTrue(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
-    const Logger& logger
-) {
-    assert(pos.valid);
-    assert(ctx.text[pos.pos] == 't');
-    if (ctx.slice(pos, 4) != "true") {
-        _logErrorAtPos(
-            logger, ctx, pos, "Invalid value. Expected to be \"true\"."
-        );
+    const auto number = toDouble(text);
+    if (!number) {
+        _logErrorAtPos(logger, ctx, startPos, "Number out of range.");
         return false;
     }
-    ctx.moveForward(pos, 4);
-    tree = true;
+    node = *number;
     return true;
 }
 
-static bool _parseFalse(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
+/// Parse one of the literal `true`, `false` and `null`.
+static bool _parseLiteral(
+    ValueNode& node,
+    const RawTextContext& ctx,
+    const char*& pos,
+    std::string_view literal,
+    const ValueNode& literalNode,
     const Logger& logger
 ) {
-    assert(pos.valid);
-    assert(ctx.text[pos.pos] == 'f');
-    if (ctx.slice(pos, 5) != "false") {
+    assert(pos < ctx.end);
+    assert(*pos == literal[0]);
+    if (size_t(ctx.end - pos) < literal.size()
+        || std::string_view(pos, literal.size()) != literal)
+    {
         _logErrorAtPos(
-            logger, ctx, pos, "Invalid value. Expected to be \"false\"."
+            logger,
+            ctx,
+            pos,
+            "Invalid value. Expected to be \"" + std::string(literal) + "\"."
         );
         return false;
     }
-    ctx.moveForward(pos, 5);
-    tree = false;
+    pos += literal.size();
+    node = literalNode;
     return true;
 }
 
-static bool _parseNull(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
+/// Result of a step of parsing.
+enum class _ParseStatus {
+    ERROR,    ///< The input is invalid, which is logged.
+    STOPPED,  ///< An event returned false.
+    MORE,     ///< Continue with the next value.
+    CLOSED,   ///< The innermost array or object is closed.
+};
+
+/// Parse a string, number or literal, and pass it to `events`.
+///
+/// `Events` is the interface of `_parseValue`, with `value(ValueNode&&)` for
+/// numbers and literals, and `string(content, buffer)` for strings, whose
+/// content is in `buffer` iff it has escapes.
+template <typename Events>
+static _ParseStatus _parseScalar(
+    Events& events,
+    std::string& buffer,
+    const RawTextContext& ctx,
+    const char*& pos,
     const Logger& logger
 ) {
-    assert(pos.valid);
-    assert(ctx.text[pos.pos] == 'n');
-    if (ctx.slice(pos, 4) != "null") {
+    // At the end of input, report the last character, like `TextContext`.
+    const auto ch = pos < ctx.end ? *pos : ctx.end[-1];
+    if (pos < ctx.end && ch == '"') {
+        const auto content = _parseStringContent(buffer, ctx, pos, logger);
+        if (!content) return _ParseStatus::ERROR;
+        return events.string(*content, buffer) ? _ParseStatus::MORE
+                                               : _ParseStatus::STOPPED;
+    }
+    ValueNode node;
+    bool parsed = false;
+    if (pos == ctx.end) {
+        // Nothing but a comment after the last separator
+        _logErrorAtPos(
+            logger,
+            ctx,
+            pos,
+            std::string("Invalid JSON value with head: '") + ch + "'."
+        );
+    } else if (ch == 't') {
+        parsed = _parseLiteral(node, ctx, pos, "true", true, logger);
+    } else if (ch == 'f') {
+        parsed = _parseLiteral(node, ctx, pos, "false", false, logger);
+    } else if (ch == 'n') {
+        parsed = _parseLiteral(node, ctx, pos, "null", NONE, logger);
+    } else if (ch == '+' || ch == '-' || std::isdigit(uint8_t(ch))) {
+        parsed = _parseNumber(node, ctx, pos, logger);
+    } else {
         _logErrorAtPos(
-            logger, ctx, pos, "Invalid value. Expected to be \"null\"."
+            logger,
+            ctx,
+            pos,
+            std::string("Invalid JSON value with head: '") + ch + "'."
         );
-        return false;
     }
-    ctx.moveForward(pos, 4);
-    tree = NONE;
-    return true;
+    if (!parsed) return _ParseStatus::ERROR;
+    return events.value(std::move(node)) ? _ParseStatus::MORE
+                                         : _ParseStatus::STOPPED;
 }
 
-static bool _parseValue(
-    ValueTree& tree,
-    const TextContext& ctx,
-    PositionInText& pos,
+/// An array or object being parsed by `_parseValue`.
+struct _ParseFrame {
+    bool isObject = false;
+
+    /// Start of the member being parsed, for error messages.
+    const char* valueStartPos = nullptr;
+};
+
+/// Parse up to the value of the next member of `frame`, passing its key to
+/// `events`.
+template <typename Events>
+static _ParseStatus _beginMember(
+    Events& events,
+    _ParseFrame& frame,
+    const RawTextContext& ctx,
+    const char*& pos,
     const Logger& logger
 ) {
-    const auto ch = ctx.text[pos.pos];
-    if (ch == '{') return _parseObject(tree, ctx, pos, logger);
-    if (ch == '[') return _parseArray(tree, ctx, pos, logger);
-    if (ch == '"') return _parseString(tree, ctx, pos, logger);
-    if (ch == 't') return _parseTrue(tree, ctx, pos, logger);
-    if (ch == 'f') return _parseFalse(tree, ctx, pos, logger);
-    if (ch == 'n') return _parseNull(tree, ctx, pos, logger);
-    if (ch == '+' || ch == '-' || std::isdigit(ch))
-        return _parseNumber(tree, ctx, pos, logger);
-    _logErrorAtPos(
-        logger,
-        ctx,
-        pos,
-        std::string("Invalid JSON value with head: '") + ch + "'."
-    );
-    return false;
-}
-
-ValueTree parse(const std::string& json, const Logger& logger) {
-    if (json.empty()) {
-        logger.error("Empty JSON.");
-        return ValueTree();
+    if (pos >= ctx.end) {
+        _logErrorAtPos(
+            logger,
+            ctx,
+            pos,
+            frame.isObject ? "Unterminated object." : "Unterminated array."
+        );
+        return _ParseStatus::ERROR;
     }
-
-    TextContext ctx = { json };
-    PositionInText pos = {
-        .valid = true, .pos = 0, .lineIdx = 0, .linePos = 0
-    };
-
-    ValueTree tree;
     _skipWhitespace(ctx, pos);
-    if (!_parseValue(tree, ctx, pos, logger)) {
-        logger.error("Failed to parse JSON.");
-        return ValueTree();
+    if (!frame.isObject) {
+        frame.valueStartPos = pos;
+        return _ParseStatus::MORE;
+    }
+    if (*pos != '"') {
+        _logErrorAtPos(
+            logger, ctx, pos, "Expected quoted string with '\"' as object key."
+        );
+        return _ParseStatus::ERROR;
+    }
+    const auto keyStartPos = pos;
+    std::string keyBuffer;
+    const auto key = _parseStringContent(keyBuffer, ctx, pos, logger);
+    if (!key) {
+        _logErrorAtPos(logger, ctx, keyStartPos, "Failed to parse object key.");
+        return _ParseStatus::ERROR;
     }
     _skipWhitespace(ctx, pos);
-
-    if (pos.valid) {
-        _logErrorAtPos(logger, ctx, pos, "Extra characters after JSON.");
+    if (pos == ctx.end || *pos != ':') {
+        _logErrorAtPos(logger, ctx, pos, "Expected ':' in object.");
+        return _ParseStatus::ERROR;
     }
-
-    return tree;
+    ++pos;
+    _skipWhitespace(ctx, pos);
+    frame.valueStartPos = pos;
+    return events.key(*key) ? _ParseStatus::MORE : _ParseStatus::STOPPED;
 }
 
-static void _escapeString(const std::string& input, std::stringstream& stream) {
-    for (const char c: input) {
-        switch (c) {
-            case '"': stream << "\\\""; break;
-            case '\\': stream << "\\\\"; break;
-            case '\b': stream << "\\b"; break;
-            case '\f': stream << "\\f"; break;
-            case '\n': stream << "\\n"; break;
-            case '\r': stream << "\\r"; break;
-            case '\t': stream << "\\t"; break;
-            default: stream << c; break;
+/// Parse the separator after a member of `frame`, or its closing bracket.
+static _ParseStatus _endMember(
+    const _ParseFrame& frame,
+    const RawTextContext& ctx,
+    const char*& pos,
+    const Logger& logger
+) {
+    const char closing = frame.isObject ? '}' : ']';
+    const auto afterValuePos = pos;
+    _skipWhitespace(ctx, pos);
+    if (pos < ctx.end && *pos == closing) {
+        ++pos;
+        return _ParseStatus::CLOSED;
+    }
+    if (pos == ctx.end || *pos != ',') {
+        if (frame.isObject) {
+            _logErrorAtPos(
+                logger,
+                ctx,
+                afterValuePos,
+                "Expected ',' or '}' at the end of object."
+            );
+        } else {
+            _logErrorAtPos(logger, ctx, pos, "Expected ',' or ']' in array.");
         }
+        return _ParseStatus::ERROR;
+    }
+    ++pos;
+    _skipWhitespace(ctx, pos);
+    // Trailing comma
+    if (pos < ctx.end && *pos == closing) {
+        ++pos;
+        return _ParseStatus::CLOSED;
     }
+    return _ParseStatus::MORE;
 }
 
-static void _dump(
-    const ValueTree& tree,
-    std::stringstream& stream,
-    bool pretty,
-    size_t indent,
-    size_t indentStep
+/// Parse a value into `events`, with an explicit stack of the enclosing
+/// arrays and objects instead of recursion, so that the depth is limited by
+/// `ParseOptions::maxDepth` rather than the call stack.
+///
+/// `Events` has `startObject()`, `key(key)`, `endObject()`, `startArray()`,
+/// `endArray()` and those of `_parseScalar`, each returning whether to
+/// continue. Return MORE if the whole value is parsed.
+template <typename Events>
+static _ParseStatus _parseValue(
+    Events& events,
+    const RawTextContext& ctx,
+    const char*& pos,
+    const ParseOptions& options,
+    const Logger& logger
 ) {
-    size_t newIndent = indent + indentStep;
-    switch (tree.state()) {
-        case ValueTree::State::EMPTY: break;
-
-        case ValueTree::State::VALUE: {
-            const auto& node = *tree.getValue();
-            switch (node.typeTag()) {
-                case TypeTag::NONE: {
-                    stream << "null";
-                } break;
-
-                case TypeTag::BOOL: {
-                    stream << (*node.value<TypeTag::BOOL>() ? "true" : "false");
-                } break;
-
-                case TypeTag::NUMBER: {
-                    stream << *node.value<TypeTag::NUMBER>();
-                } break;
+    // Frames up to a depth of 128 fit in this buffer, so that usual input is
+    // parsed without allocating.
+    alignas(_ParseFrame) std::byte frameBuffer[4096];
+    std::pmr::monotonic_buffer_resource frameResource(
+        frameBuffer, sizeof(frameBuffer)
+    );
+    std::pmr::vector<_ParseFrame> frames(&frameResource);
+    // Unescaped strings, reused for all values.
+    std::string buffer;
+    // On failure, each enclosing array and object reports its member, from
+    // the innermost one of the first `depth` frames.
+    const auto fail = [&](size_t depth) {
+        while (depth-- > 0) {
+            _logErrorAtPos(
+                logger,
+                ctx,
+                frames[depth].valueStartPos,
+                frames[depth].isObject ? "Failed to parse object value."
+                                       : "Failed to parse array value."
+            );
+        }
+        return _ParseStatus::ERROR;
+    };
 
-                case TypeTag::STRING: {
-                    stream << '"';
-                    _escapeString(*node.value<TypeTag::STRING>(), stream);
-                    stream << '"';
-                } break;
+    while (true) {
+        const bool isObject = pos < ctx.end && *pos == '{';
+        if (isObject || (pos < ctx.end && *pos == '[')) {
+            if (frames.size() >= options.maxDepth) {
+                _logErrorAtPos(
+                    logger,
+                    ctx,
+                    pos,
+                    "Exceeded maximum depth of "
+                        + std::to_string(options.maxDepth) + "."
+                );
+                return fail(frames.size());
             }
-        } break;
-
-        case ValueTree::State::ARRAY: {
-            const auto& array = *tree.getArray();
-            if (pretty) {
-                stream << '[';
-                bool first = true;
-                bool isEmpty = true;
-                for (const auto& value: array) {
-                    if (value.isEmpty()) continue;
-                    if (first) first = false;
-                    else stream << ',';
-                    stream << '\n' << std::string(newIndent, ' ');
-                    _dump(value, stream, pretty, newIndent, indentStep);
-                    isEmpty = false;
+            if (!(isObject ? events.startObject() : events.startArray())) {
+                return _ParseStatus::STOPPED;
+            }
+            ++pos;  // Skip initial bracket
+            _skipWhitespace(ctx, pos);
+            if (pos < ctx.end && *pos == (isObject ? '}' : ']')) {
+                // Empty array or object
+                ++pos;
+                if (!(isObject ? events.endObject() : events.endArray())) {
+                    return _ParseStatus::STOPPED;
                 }
-                if (!isEmpty) stream << '\n' << std::string(indent, ' ');
-                stream << ']';
             } else {
-                stream << '[';
-                bool first = true;
-                for (const auto& value: array) {
-                    if (value.isEmpty()) continue;
-                    if (first) first = false;
-                    else stream << ',';
-                    _dump(value, stream, pretty, newIndent, indentStep);
+                frames.push_back({ isObject });
+                const auto status =
+                    _beginMember(events, frames.back(), ctx, pos, logger);
+                if (status == _ParseStatus::ERROR) {
+                    return fail(frames.size() - 1);
                 }
-                stream << ']';
+                if (status == _ParseStatus::STOPPED) return status;
+                continue;
             }
-        } break;
+        } else {
+            const auto status = _parseScalar(events, buffer, ctx, pos, logger);
+            if (status == _ParseStatus::ERROR) return fail(frames.size());
+            if (status == _ParseStatus::STOPPED) return status;
+        }
 
-        case ValueTree::State::OBJECT: {
-            const auto& object = *tree.getObject();
-            if (pretty) {
-                stream << '{';
-                bool first = true;
-                bool isEmpty = true;
-                for (const auto& [key, value]: object) {
-                    if (value.isEmpty()) continue;
-                    if (first) first = false;
-                    else stream << ',';
-                    stream << '\n' << std::string(newIndent, ' ');
-                    _dump(
-                        ValueTree(key), stream, pretty, newIndent, indentStep
-                    );
-                    stream << ": ";
-                    _dump(value, stream, pretty, newIndent, indentStep);
-                    isEmpty = false;
-                }
-                if (!isEmpty) stream << '\n' << std::string(indent, ' ');
-                stream << '}';
-            } else {
-                stream << '{';
-                bool first = true;
-                for (const auto& [key, value]: object) {
-                    if (value.isEmpty()) continue;
-                    if (first) first = false;
-                    else stream << ',';
-                    stream << '"' << key << '"' << ':';
-                    _dump(value, stream, pretty, newIndent, indentStep);
-                }
-                stream << '}';
+        // Close the arrays and objects ending after the value, and begin the
+        // next member of the innermost open one.
+        while (true) {
+            if (frames.empty()) return _ParseStatus::MORE;
+            const auto status = _endMember(frames.back(), ctx, pos, logger);
+            if (status == _ParseStatus::ERROR) return fail(frames.size() - 1);
+            if (status == _ParseStatus::MORE) break;
+            const bool closedObject = frames.back().isObject;
+            frames.pop_back();
+            if (!(closedObject ? events.endObject() : events.endArray())) {
+                return _ParseStatus::STOPPED;
             }
-        } break;
+        }
+        const auto status =
+            _beginMember(events, frames.back(), ctx, pos, logger);
+        if (status == _ParseStatus::ERROR) return fail(frames.size() - 1);
+        if (status == _ParseStatus::STOPPED) return status;
     }
 }
 
-std::string dump(const ValueTree& tree, bool pretty, size_t indentStep) {
-    std::stringstream stream;
-    _dump(tree, stream, pretty, 0, indentStep);
-    return stream.str();
+/// Builds a ValueTree from the events of `_parseValue`.
+class _TreeBuilder
+{
+  public:
+
+    _TreeBuilder(ValueTree& tree, const ParseOptions& options)
+        : _value(&tree), _options(options) {}
+
+    bool startObject() {
+        _containers.push_back(
+            { nullptr, &_next().asObject(_options.resource) }
+        );
+        return true;
+    }
+
+    bool key(std::string_view key) {
+        _value = &(*_containers.back().object)[ObjectKey(key)];
+        return true;
+    }
+
+    bool endObject() {
+        _containers.pop_back();
+        return true;
+    }
+
+    bool startArray() {
+        _containers.push_back(
+            { &_next().asArray(_options.resource), nullptr }
+        );
+        return true;
+    }
+
+    bool endArray() {
+        _containers.pop_back();
+        return true;
+    }
+
+    bool value(ValueNode&& node) {
+        _next() = std::move(node);
+        return true;
+    }
+
+    bool string(std::string_view content, std::string& buffer) {
+        if (content.data() == buffer.data()) {
+            _next() = std::move(buffer);
+        } else if (_options.viewStrings) {
+            _next() = ValueNode::view(content);
+        } else {
+            _next() = std::string(content);
+        }
+        return true;
+    }
+
+  private:
+
+    /// Exactly one of `array` and `object` is set.
+    struct _Container {
+        ArrayNode* array;
+        ObjectNode* object;
+    };
+
+    /// Where the next value goes: a new element of the innermost array, or
+    /// the member of the last key.
+    ValueTree& _next() {
+        if (!_containers.empty() && _containers.back().array) {
+            return _containers.back().array->emplace_back();
+        }
+        return *_value;
+    }
+
+    std::vector<_Container> _containers;
+    ValueTree* _value;
+    const ParseOptions& _options;
+};
+
+/// Builds a ValueTree from the events of `_parseValue` into an existing tree,
+/// reusing its arrays, members and strings where the shape matches, see
+/// `parseInto`. The result is the same as of `_TreeBuilder` into an empty
+/// tree.
+class _ReusingBuilder
+{
+  public:
+
+    _ReusingBuilder(ValueTree& tree, const ParseOptions& options)
+        : _value(&tree), _options(options) {}
+
+    bool startObject() {
+        auto& tree = _next();
+        _Container container = {
+            nullptr, 0, nullptr, ObjectNode(_options.resource)
+        };
+        if (_isOld && tree.isObject()) {
+            detachMembers(*tree.getObject(), container.spare);
+        }
+        container.object = &tree.asObject(_options.resource);
+        _containers.push_back(std::move(container));
+        return true;
+    }
+
+    bool key(std::string_view key) {
+        auto& container = _containers.back();
+        auto& object = *container.object;
+        const auto it = object.find(key);
+        if (it != object.end()) {
+            // A repeated key, whose member is merged as by `_TreeBuilder`.
+            _value = &it->second;
+            _isOld = false;
+        } else if (auto member = takeMember(container.spare, key, object)) {
+            _value = member;
+            _isOld = true;
+        } else {
+            _value = &object[ObjectKey(key)];
+            _isOld = false;
+        }
+        return true;
+    }
+
+    bool endObject() {
+        // Members of the old object which are NOT reused are dropped here.
+        _containers.pop_back();
+        return true;
+    }
+
+    bool startArray() {
+        auto& tree = _next();
+        const bool isReused = _isOld && tree.isArray();
+        auto& array = tree.asArray(_options.resource);
+        _containers.push_back(
+            { &array, isReused ? 0 : array.size(), nullptr, ObjectNode() }
+        );
+        return true;
+    }
+
+    bool endArray() {
+        auto& container = _containers.back();
+        auto& array = *container.array;
+        array.erase(array.begin() + container.count, array.end());
+        _containers.pop_back();
+        return true;
+    }
+
+    bool value(ValueNode&& node) {
+        _next() = std::move(node);
+        return true;
+    }
+
+    bool string(std::string_view content, std::string& buffer) {
+        auto& tree = _next();
+        if (_options.viewStrings && content.data() != buffer.data()) {
+            tree = ValueNode::view(content);
+        } else if (_isOld && tree.isValue()) {
+            tree.asValue().setString(content);
+        } else if (content.data() == buffer.data()) {
+            tree = std::move(buffer);
+        } else {
+            tree = std::string(content);
+        }
+        return true;
+    }
+
+  private:
+
+    /// Exactly one of `array` and `object` is set.
+    struct _Container {
+        ArrayNode* array;
+        /// Elements of `array` so far. Those after them are old ones.
+        size_t count;
+        ObjectNode* object;
+        /// Old members of `object` which are NOT reached yet.
+        ObjectNode spare;
+    };
+
+    /// Where the next value goes: the next element of the innermost array,
+    /// or the member of the last key. `_isOld` is set if it still holds the
+    /// value of the old tree, which is then overwritten in place.
+    ValueTree& _next() {
+        ValueTree* next = _value;
+        if (!_containers.empty() && _containers.back().array) {
+            auto& container = _containers.back();
+            auto& array = *container.array;
+            _isOld = container.count < array.size();
+            next = _isOld ? &array[container.count] : &array.emplace_back();
+            ++container.count;
+        }
+        if (_isOld && !isReusable(*next, _options.resource)) {
+            next->clear();
+            _isOld = false;
+        }
+        return *next;
+    }
+
+    std::vector<_Container> _containers;
+    ValueTree* _value;
+    bool _isOld = true;
+    const ParseOptions& _options;
+};
+
+/// Passes the events of `_parseValue` to a `Handler`.
+struct _HandlerEvents {
+    Handler& handler;
+
+    bool startObject() { return handler.startObject(); }
+    bool key(std::string_view key) { return handler.key(key); }
+    bool endObject() { return handler.endObject(); }
+    bool startArray() { return handler.startArray(); }
+    bool endArray() { return handler.endArray(); }
+    bool value(ValueNode&& node) { return handler.value(node); }
+
+    bool string(std::string_view content, std::string&) {
+        return handler.value(ValueNode::view(content));
+    }
+};
+
+/// Parse a whole JSON text into `events`.
+template <typename Events>
+static _ParseStatus _parse(
+    const RawTextContext& ctx,
+    Events& events,
+    const ParseOptions& options,
+    const Logger& logger
+) {
+    if (ctx.begin == ctx.end) {
+        logger.error("Empty JSON.");
+        return _ParseStatus::ERROR;
+    }
+
+    const char* pos = ctx.begin;
+
+    _skipWhitespace(ctx, pos);
+    const auto status = _parseValue(events, ctx, pos, options, logger);
+    if (status == _ParseStatus::ERROR) {
+        logger.error("Failed to parse JSON.");
+    }
+    if (status != _ParseStatus::MORE) return status;
+    _skipWhitespace(ctx, pos);
+
+    if (pos < ctx.end) {
+        _logErrorAtPos(logger, ctx, pos, "Extra characters after JSON.");
+    }
+
+    return status;
+}
+
+/// Run `task(index)` for each index in `[0, count)` on its own thread, the
+/// last one on the calling thread, and wait for all of them.
+template <typename Task>
+static void _runParallel(size_t count, const Task& task) {
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+    for (size_t idx = 0; idx + 1 < count; ++idx) {
+        threads.emplace_back(task, idx);
+    }
+    task(count - 1);
+    for (auto& thread: threads) thread.join();
+}
+
+/// Number of threads for `options.threads`, with at least `minBytes` of the
+/// input for each.
+static size_t _threadCount(
+    const ParseOptions& options, size_t inputSize, size_t minBytes
+) {
+    size_t count = options.threads;
+    if (count == 0) count = std::max(std::thread::hardware_concurrency(), 1u);
+    return std::min(count, inputSize / minBytes + 1);
+}
+
+/// Split the members of the array or object opening at `pos` into about
+/// `count` ranges of whole members, for `_parseParallel`. Strings and comments
+/// are skipped, so that brackets and separators in them do NOT count.
+///
+/// Return the start of each range, followed by the closing bracket.
+/// Return nothing if the brackets are unbalanced or a string is NOT closed.
+static std::vector<const char*> _splitMembers(
+    const RawTextContext& ctx, const char* pos, size_t count
+) {
+    const size_t size = size_t(ctx.end - pos);
+    std::vector<const char*> splits = { ++pos };
+    const char* splitPos = splits.back() + size / count;
+    size_t depth = 1;
+    while (pos < ctx.end) {
+        if (depth == 1 && pos >= splitPos && splits.size() < count) {
+            // Split after the next separator of members, looking at every
+            // character until then.
+            if (*pos == ',') {
+                splits.push_back(++pos);
+                splitPos = splits[0] + size * splits.size() / count;
+                continue;
+            }
+        } else {
+            pos = scanPlainChars(pos, ctx.end);
+            if (pos == ctx.end) break;
+        }
+        switch (*pos) {
+            case '"': {
+                ++pos;
+                while (true) {
+                    pos = scanStringChars(pos, ctx.end);
+                    if (pos == ctx.end || RawTextContext::isLineBreak(*pos)) {
+                        return {};
+                    }
+                    if (*pos == '"') break;
+                    if (pos + 1 == ctx.end) return {};
+                    pos += 2;  // Skip an escaped character
+                }
+                ++pos;
+            } break;
+            case '/': {
+                if (pos + 1 < ctx.end && pos[1] == '/') {
+                    pos = scanLineChars(pos, ctx.end);
+                } else {
+                    ++pos;
+                }
+            } break;
+            case '[':
+            case '{': {
+                ++depth;
+                ++pos;
+            } break;
+            case ']':
+            case '}': {
+                if (--depth == 0) {
+                    splits.push_back(pos);
+                    return splits;
+                }
+                ++pos;
+            } break;
+            default: {
+                ++pos;
+            } break;
+        }
+    }
+    return {};
+}
+
+/// Parse the members of an array or object in `[pos, ctx.end)`, which is a
+/// range of `_splitMembers`, into `events`. Errors are NOT reported.
+template <typename Events>
+static bool _parseMembers(
+    Events& events,
+    bool isObject,
+    const RawTextContext& ctx,
+    const char*& pos,
+    const ParseOptions& options
+) {
+    const Logger logger;
+    std::string keyBuffer;
+    while (true) {
+        _skipWhitespace(ctx, pos);
+        if (pos == ctx.end) return true;
+        if (isObject) {
+            if (*pos != '"') return false;
+            const auto key = _parseStringContent(keyBuffer, ctx, pos, logger);
+            if (!key) return false;
+            _skipWhitespace(ctx, pos);
+            if (pos == ctx.end || *pos != ':') return false;
+            ++pos;
+            _skipWhitespace(ctx, pos);
+            events.key(*key);
+        }
+        if (_parseValue(events, ctx, pos, options, logger)
+            != _ParseStatus::MORE)
+        {
+            return false;
+        }
+        _skipWhitespace(ctx, pos);
+        if (pos == ctx.end) return true;
+        if (*pos != ',') return false;
+        ++pos;
+    }
+}
+
+/// Move the members of `from` to the end of `to`, without copying them.
+/// Return false if a key is in both.
+static bool _moveMembers(ObjectNode& from, ObjectNode& to) {
+#ifdef C2P_FLAT_OBJECT_NODE
+    to.reserve(to.size() + from.size());
+    for (auto& [key, value]: from) {
+        if (!to.emplace(std::move(key), std::move(value)).second) return false;
+    }
+    return true;
+#else
+    to.merge(from);
+    return from.empty();
+#endif
+}
+
+/// Parse a large array or object at the root of `json` with several
+/// threads, each parsing a range of its members into a part which is moved
+/// into the result.
+///
+/// Return std::nullopt if `json` is NOT such a document, or if it has any
+/// error, so that the sequential parser reports it at the same position.
+/// Keys repeated in different ranges also fall back to the sequential
+/// parser, which merges them.
+static std::optional<ValueTree> _parseParallel(
+    const RawTextContext& ctx, const ParseOptions& options
+) {
+    // Splitting is sequential, so each thread needs a large range.
+    constexpr size_t MIN_RANGE_SIZE = 256 * 1024;
+    const size_t rangeCount =
+        _threadCount(options, size_t(ctx.end - ctx.begin), MIN_RANGE_SIZE);
+    if (rangeCount < 2 || options.maxDepth == 0) return std::nullopt;
+
+    const char* pos = ctx.begin;
+    _skipWhitespace(ctx, pos);
+    if (pos == ctx.end || (*pos != '[' && *pos != '{')) return std::nullopt;
+    const bool isObject = *pos == '{';
+    const auto splits = _splitMembers(ctx, pos, rangeCount);
+    if (splits.empty()) return std::nullopt;
+
+    // Nothing but whitespaces and comments may follow.
+    pos = splits.back() + 1;
+    _skipWhitespace(ctx, pos);
+    if (pos < ctx.end) return std::nullopt;
+
+    // Members are one level below the root.
+    ParseOptions memberOptions = options;
+    --memberOptions.maxDepth;
+    std::vector<ValueTree> parts(splits.size() - 1);
+    std::vector<char> isParsed(parts.size(), false);
+    _runParallel(parts.size(), [&](size_t idx) {
+        const RawTextContext rangeCtx(splits[idx], splits[idx + 1]);
+        const char* rangePos = rangeCtx.begin;
+        _TreeBuilder builder(parts[idx], memberOptions);
+        if (isObject) {
+            builder.startObject();
+        } else {
+            builder.startArray();
+        }
+        isParsed[idx] = _parseMembers(
+            builder, isObject, rangeCtx, rangePos, memberOptions
+        );
+    });
+    for (const bool parsed: isParsed) {
+        if (!parsed) return std::nullopt;
+    }
+
+    ValueTree tree = std::move(parts[0]);
+    if (isObject) {
+        auto& object = tree.asObject(options.resource);
+        for (size_t idx = 1; idx < parts.size(); ++idx) {
+            if (!_moveMembers(parts[idx].asObject(options.resource), object)) {
+                return std::nullopt;
+            }
+        }
+    } else {
+        auto& array = tree.asArray(options.resource);
+        size_t size = 0;
+        for (auto& part: parts) size += part.asArray(options.resource).size();
+        array.reserve(size);
+        for (size_t idx = 1; idx < parts.size(); ++idx) {
+            for (auto& element: parts[idx].asArray(options.resource)) {
+                array.push_back(std::move(element));
+            }
+        }
+    }
+    return tree;
+}
+
+/// Parse `ctx` into ValueTree, see `parse`.
+static ValueTree _parseTree(
+    const RawTextContext& ctx, const ParseOptions& options, const Logger& logger
+) {
+    ParseOptions resolvedOptions = options;
+    if (!resolvedOptions.resource) {
+        resolvedOptions.resource = std::pmr::get_default_resource();
+    }
+
+    if (resolvedOptions.threads != 1) {
+        if (auto tree = _parseParallel(ctx, resolvedOptions)) {
+            return std::move(*tree);
+        }
+    }
+
+    ValueTree tree;
+    _TreeBuilder builder(tree, resolvedOptions);
+    if (_parse(ctx, builder, resolvedOptions, logger) != _ParseStatus::MORE) {
+        return ValueTree();
+    }
+    return tree;
+}
+
+ValueTree parse(const std::string& json, const Logger& logger) {
+    return parse(json, ParseOptions(), logger);
+}
+
+ValueTree parse(
+    const std::string& json, MemoryResource* resource, const Logger& logger
+) {
+    return parse(json, ParseOptions{ .resource = resource }, logger);
+}
+
+ValueTree parse(
+    const std::string& json, const ParseOptions& options, const Logger& logger
+) {
+    return _parseTree(json, options, logger);
+}
+
+bool parseInto(
+    ValueTree& tree,
+    const std::string& json,
+    const ParseOptions& options,
+    const Logger& logger
+) {
+    ParseOptions resolvedOptions = options;
+    if (!resolvedOptions.resource) {
+        resolvedOptions.resource = std::pmr::get_default_resource();
+    }
+
+    _ReusingBuilder builder(tree, resolvedOptions);
+    if (_parse(json, builder, resolvedOptions, logger) != _ParseStatus::MORE) {
+        tree.clear();
+        return false;
+    }
+    return true;
+}
+
+ValueTree parseFile(
+    const std::string& path, const ParseOptions& options, const Logger& logger
+) {
+    size_t size = 0;
+    const auto data = mapFile(path, size, logger);
+    if (!data) return ValueTree();
+
+    // Strings are copied out of the mapping, which is unmapped on return.
+    ParseOptions fileOptions = options;
+    fileOptions.viewStrings = false;
+    const RawTextContext ctx(data.get(), data.get() + size);
+    return _parseTree(ctx, fileOptions, fileLogger(path, logger));
+}
+
+bool parse(const std::string& json, Handler& handler, const Logger& logger) {
+    return parse(json, handler, ParseOptions(), logger);
+}
+
+bool parse(
+    const std::string& json,
+    Handler& handler,
+    const ParseOptions& options,
+    const Logger& logger
+) {
+    _HandlerEvents events = { handler };
+    return _parse(json, events, options, logger) == _ParseStatus::MORE;
+}
+
+/// Lines of `parseLines` parsed by one thread.
+struct _LinesChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    /// Index of the first line in the whole input.
+    size_t firstLineIdx = 0;
+    std::vector<ValueTree> trees;
+    std::vector<std::string> errors;
+};
+
+std::vector<ValueTree> parseLines(
+    const std::string& lines, const ParseOptions& options, const Logger& logger
+) {
+    ParseOptions resolvedOptions = options;
+    if (!resolvedOptions.resource) {
+        resolvedOptions.resource = std::pmr::get_default_resource();
+    }
+
+    // Split into chunks ending with line breaks. Small chunks are NOT worth
+    // a thread.
+    constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+    const size_t chunkCount =
+        _threadCount(resolvedOptions, lines.size(), MIN_CHUNK_SIZE);
+    std::vector<_LinesChunk> chunks(chunkCount);
+    const char* const end = lines.data() + lines.size();
+    const char* chunkBegin = lines.data();
+    for (size_t idx = 0; idx < chunkCount; ++idx) {
+        auto& chunk = chunks[idx];
+        chunk.begin = chunkBegin;
+        chunk.end = end;
+        if (idx + 1 < chunkCount) {
+            const char* const splitPos = std::max(
+                chunkBegin, lines.data() + lines.size() * (idx + 1) / chunkCount
+            );
+            const auto lineBreakPos = static_cast<const char*>(
+                std::memchr(splitPos, '\n', size_t(end - splitPos))
+            );
+            if (lineBreakPos) chunk.end = lineBreakPos + 1;
+        }
+        chunkBegin = chunk.end;
+    }
+
+    // Line numbers of errors need the count of lines before each chunk.
+    _runParallel(chunkCount, [&](size_t idx) {
+        auto& chunk = chunks[idx];
+        chunk.firstLineIdx = size_t(std::count(chunk.begin, chunk.end, '\n'));
+    });
+    size_t lineCount = 0;
+    for (auto& chunk: chunks) {
+        std::swap(lineCount, chunk.firstLineIdx);
+        lineCount += chunk.firstLineIdx;
+    }
+
+    _runParallel(chunkCount, [&](size_t idx) {
+        auto& chunk = chunks[idx];
+        const Logger chunkLogger([&chunk](const std::string& msg) {
+            chunk.errors.push_back(msg);
+        });
+        PositionInText origin = {
+            .valid = true,
+            .pos = uint32_t(chunk.begin - lines.data()),
+            .lineIdx = uint32_t(chunk.firstLineIdx),
+            .linePos = 0,
+        };
+        for (const char* lineBegin = chunk.begin; lineBegin < chunk.end;) {
+            auto lineEnd = static_cast<const char*>(
+                std::memchr(lineBegin, '\n', size_t(chunk.end - lineBegin))
+            );
+            if (!lineEnd) lineEnd = chunk.end;
+            RawTextContext ctx(lineBegin, lineEnd);
+            ctx.origin = origin;
+            const char* pos = lineBegin;
+            _skipWhitespace(ctx, pos);
+            if (pos < lineEnd) {
+                auto& tree = chunk.trees.emplace_back();
+                _TreeBuilder builder(tree, resolvedOptions);
+                if (_parse(ctx, builder, resolvedOptions, chunkLogger)
+                    != _ParseStatus::MORE)
+                {
+                    tree = ValueTree();
+                }
+            }
+            origin.pos += uint32_t(lineEnd + 1 - lineBegin);
+            ++origin.lineIdx;
+            lineBegin = lineEnd + 1;
+        }
+    });
+
+    size_t treeCount = 0;
+    for (const auto& chunk: chunks) treeCount += chunk.trees.size();
+    std::vector<ValueTree> trees;
+    trees.reserve(treeCount);
+    for (auto& chunk: chunks) {
+        for (const auto& error: chunk.errors) logger.error(error);
+        for (auto& tree: chunk.trees) trees.push_back(std::move(tree));
+    }
+    return trees;
+}
+
+/// State of a `PushParser` between chunks.
+struct PushParser::_Parser {
+
+    /// What is expected next, besides whitespaces and comments.
+    enum class _Expect {
+        VALUE,
+        ELEMENT,      ///< A value, or ']' after '[' or ','.
+        MEMBER,       ///< A key, or '}' after '{' or ','.
+        COLON,        ///< ':' after a key.
+        SEPARATOR,    ///< ',' or the closing bracket after a value.
+        END,          ///< Nothing, after the whole value.
+    };
+
+    _Parser(const ParseOptions& options, const Logger& logger)
+        : options(options), logger(logger), builder(tree, this->options) {
+        if (!this->options.resource) {
+            this->options.resource = std::pmr::get_default_resource();
+        }
+        // Chunks do NOT outlive `feed`.
+        this->options.viewStrings = false;
+    }
+
+    ParseOptions options;
+    Logger logger;
+    ValueTree tree;
+    _TreeBuilder builder;
+
+    /// Whether each open array or object is an object.
+    std::vector<bool> frames;
+    _Expect expect = _Expect::VALUE;
+    bool inComment = false;
+    bool isFed = false;
+    bool isFailed = false;
+    bool hasExtraCharacters = false;
+
+    /// Unparsed end of the previous chunks, starting with a split token.
+    std::string tail;
+    /// Bytes of the split token at the start of `tail` which are scanned.
+    size_t scanned = 0;
+    /// Position of the start of `tail` in the whole input.
+    PositionInText origin = {
+        .valid = true, .pos = 0, .lineIdx = 0, .linePos = 0
+    };
+    /// Unescaped strings, reused for all values.
+    std::string buffer;
+
+    /// Parse `[begin, end)`, which starts with `tail` if any, and keep its
+    /// unparsed end in `tail`. At the `end` of input, parse split tokens as
+    /// they are.
+    bool run(const char* begin, const char* end, bool atEnd) {
+        RawTextContext ctx(begin, end);
+        ctx.origin = origin;
+        const char* pos = begin;
+        if (!parse(ctx, pos, atEnd)) {
+            logger.error("Failed to parse JSON.");
+            isFailed = true;
+            tail.clear();
+            return false;
+        }
+        // Keep a last '\r' until the next chunk tells if it is "\r\n".
+        if (!atEnd && pos > begin && pos[-1] == '\r') --pos;
+        advance(begin, pos);
+        if (begin == tail.data()) {
+            tail.erase(0, pos - begin);
+        } else {
+            tail.assign(pos, end);
+        }
+        return true;
+    }
+
+    /// Move `origin` over the parsed text `[begin, end)`, counting lines same
+    /// as `RawTextContext::locate`.
+    void advance(const char* begin, const char* end) {
+        for (const char* pos = begin; pos < end;) {
+            const auto lineEndPos = scanLineChars(pos, end);
+            origin.pos += uint32_t(lineEndPos - pos);
+            origin.linePos += uint32_t(lineEndPos - pos);
+            if (lineEndPos == end) break;
+            ++origin.pos;
+            if (*lineEndPos == '\r' && lineEndPos + 1 < end
+                && lineEndPos[1] == '\n')
+            {
+                ++origin.linePos;
+            } else {
+                ++origin.lineIdx;
+                origin.linePos = 0;
+            }
+            pos = lineEndPos + 1;
+        }
+    }
+
+    /// Skip whitespaces and comments. Return false if more input is needed
+    /// to tell whether a comment starts.
+    bool skip(const RawTextContext& ctx, const char*& pos, bool atEnd) {
+        while (pos < ctx.end) {
+            if (inComment) {
+                pos = scanLineChars(pos, ctx.end);
+                if (pos < ctx.end) inComment = false;
+            } else if (std::isspace(uint8_t(*pos))) {
+                pos = scanWhitespace(pos, ctx.end);
+            } else if (*pos == '/' && pos + 1 == ctx.end && !atEnd) {
+                return false;
+            } else if (*pos == '/' && pos + 1 < ctx.end && pos[1] == '/') {
+                inComment = true;
+                pos += 2;
+            } else {
+                break;
+            }
+        }
+        return true;
+    }
+
+    /// Check if the token at `pos` ends before `ctx.end`, with at least one
+    /// more character to tell how it ends.
+    bool isComplete(const RawTextContext& ctx, const char* pos) {
+        const char head = *pos;
+        if (head == '"') {
+            const char* scanPos = pos + std::max<size_t>(scanned, 1);
+            while (true) {
+                scanPos = scanStringChars(scanPos, ctx.end);
+                if (scanPos + 1 >= ctx.end) break;
+                if (*scanPos != '\\') return true;  // Quote or line break
+                scanPos += 2;  // Skip an escaped character
+            }
+            if (scanPos < ctx.end && (*scanPos == '"' || *scanPos == '\n')) {
+                return true;
+            }
+            scanned = size_t(std::min(scanPos, ctx.end) - pos);
+            return false;
+        }
+        if (head == 't' || head == 'n') return ctx.end - pos >= 4;
+        if (head == 'f') return ctx.end - pos >= 5;
+        if (head == '+' || head == '-' || std::isdigit(uint8_t(head))) {
+            const auto numberEndPos =
+                std::find_if(pos, ctx.end, [](char c) {
+                    return !std::isdigit(uint8_t(c)) && c != '+' && c != '-'
+                        && c != '.' && c != 'e' && c != 'E';
+                });
+            return numberEndPos < ctx.end;
+        }
+        return true;
+    }
+
+    void close() {
+        const bool isObject = frames.back();
+        frames.pop_back();
+        if (isObject) {
+            builder.endObject();
+        } else {
+            builder.endArray();
+        }
+        expect = frames.empty() ? _Expect::END : _Expect::SEPARATOR;
+    }
+
+    /// Parse as far as the input goes. Return false if it is invalid.
+    bool parse(const RawTextContext& ctx, const char*& pos, bool atEnd) {
+        while (true) {
+            if (!skip(ctx, pos, atEnd) || pos == ctx.end) return true;
+            const char head = *pos;
+            switch (expect) {
+                case _Expect::END: {
+                    if (!hasExtraCharacters) {
+                        _logErrorAtPos(
+                            logger, ctx, pos, "Extra characters after JSON."
+                        );
+                        hasExtraCharacters = true;
+                    }
+                    pos = ctx.end;
+                    return true;
+                }
+                case _Expect::COLON: {
+                    if (head != ':') {
+                        _logErrorAtPos(
+                            logger, ctx, pos, "Expected ':' in object."
+                        );
+                        return false;
+                    }
+                    ++pos;
+                    expect = _Expect::VALUE;
+                } break;
+                case _Expect::SEPARATOR: {
+                    if (head == (frames.back() ? '}' : ']')) {
+                        ++pos;
+                        close();
+                    } else if (head == ',') {
+                        ++pos;
+                        expect =
+                            frames.back() ? _Expect::MEMBER : _Expect::ELEMENT;
+                    } else {
+                        _logErrorAtPos(
+                            logger,
+                            ctx,
+                            pos,
+                            frames.back()
+                                ? "Expected ',' or '}' at the end of object."
+                                : "Expected ',' or ']' in array."
+                        );
+                        return false;
+                    }
+                } break;
+                case _Expect::MEMBER: {
+                    if (head == '}') {
+                        ++pos;
+                        close();
+                        break;
+                    }
+                    if (head != '"') {
+                        _logErrorAtPos(
+                            logger,
+                            ctx,
+                            pos,
+                            "Expected quoted string with '\"' as object key."
+                        );
+                        return false;
+                    }
+                    if (!atEnd && !isComplete(ctx, pos)) return true;
+                    scanned = 0;
+                    const auto keyStartPos = pos;
+                    const auto key =
+                        _parseStringContent(buffer, ctx, pos, logger);
+                    if (!key) {
+                        _logErrorAtPos(
+                            logger,
+                            ctx,
+                            keyStartPos,
+                            "Failed to parse object key."
+                        );
+                        return false;
+                    }
+                    builder.key(*key);
+                    expect = _Expect::COLON;
+                } break;
+                case _Expect::ELEMENT:
+                case _Expect::VALUE: {
+                    if (expect == _Expect::ELEMENT && head == ']') {
+                        ++pos;
+                        close();
+                        break;
+                    }
+                    const bool isObject = head == '{';
+                    if (isObject || head == '[') {
+                        if (frames.size() >= options.maxDepth) {
+                            _logErrorAtPos(
+                                logger,
+                                ctx,
+                                pos,
+                                "Exceeded maximum depth of "
+                                    + std::to_string(options.maxDepth) + "."
+                            );
+                            return false;
+                        }
+                        ++pos;
+                        if (isObject) {
+                            builder.startObject();
+                        } else {
+                            builder.startArray();
+                        }
+                        frames.push_back(isObject);
+                        expect = isObject ? _Expect::MEMBER : _Expect::ELEMENT;
+                        break;
+                    }
+                    if (!atEnd && !isComplete(ctx, pos)) return true;
+                    scanned = 0;
+                    const auto status =
+                        _parseScalar(builder, buffer, ctx, pos, logger);
+                    if (status != _ParseStatus::MORE) return false;
+                    expect =
+                        frames.empty() ? _Expect::END : _Expect::SEPARATOR;
+                } break;
+            }
+        }
+    }
+
+    /// Report input which ends before the whole value.
+    void failAtEnd() {
+        std::string msg = "Empty JSON.";
+        if (!frames.empty()) {
+            if (expect == _Expect::COLON) {
+                msg = "Expected ':' in object.";
+            } else if (expect == _Expect::SEPARATOR) {
+                msg = frames.back()
+                        ? "Expected ',' or '}' at the end of object."
+                        : "Expected ',' or ']' in array.";
+            } else {
+                msg = frames.back() ? "Unterminated object."
+                                    : "Unterminated array.";
+            }
+            msg = origin.toString() + ": " + msg;
+        }
+        logger.error(msg);
+        logger.error("Failed to parse JSON.");
+        isFailed = true;
+    }
+};
+
+PushParser::PushParser(const ParseOptions& options, const Logger& logger)
+    : _parser(std::make_unique<_Parser>(options, logger)) {}
+
+PushParser::PushParser(PushParser&&) noexcept = default;
+PushParser& PushParser::operator=(PushParser&&) noexcept = default;
+PushParser::~PushParser() = default;
+
+PushParser::_Parser& PushParser::_get() {
+    // Moved from, see `PushParser(PushParser&&)`.
+    if (!_parser) {
+        _parser = std::make_unique<_Parser>(ParseOptions(), Logger());
+    }
+    return *_parser;
+}
+
+bool PushParser::feed(const char* data, size_t size) {
+    auto& parser = _get();
+    if (parser.isFailed) return false;
+    if (size == 0) return true;
+    parser.isFed = true;
+    if (parser.tail.empty()) return parser.run(data, data + size, false);
+    parser.tail.append(data, size);
+    return parser.run(
+        parser.tail.data(), parser.tail.data() + parser.tail.size(), false
+    );
+}
+
+ValueTree PushParser::finish() {
+    auto& parser = _get();
+    if (!parser.isFailed && !parser.tail.empty()) {
+        parser.run(
+            parser.tail.data(), parser.tail.data() + parser.tail.size(), true
+        );
+    }
+    if (!parser.isFailed && parser.expect != _Parser::_Expect::END) {
+        if (!parser.isFed) {
+            parser.logger.error("Empty JSON.");
+            parser.isFailed = true;
+        } else {
+            parser.failAtEnd();
+        }
+    }
+    ValueTree tree;
+    if (!parser.isFailed) tree = std::move(parser.tree);
+    _parser = std::make_unique<_Parser>(parser.options, parser.logger);
+    return tree;
+}
+
+std::optional<LazyDocument> LazyDocument::index(
+    std::string json, const ParseOptions& options, const Logger& logger
+) {
+    if (json.empty()) {
+        logger.error("Empty JSON.");
+        return std::nullopt;
+    }
+    if (json.size() > std::numeric_limits<uint32_t>::max()) {
+        logger.error("JSON is too large for a lazy document.");
+        return std::nullopt;
+    }
+
+    LazyDocument document;
+    document._json = std::make_unique<const std::string>(std::move(json));
+    document._options = options;
+    if (!document._options.resource) {
+        document._options.resource = std::pmr::get_default_resource();
+    }
+    document._logger = logger;
+
+    // Match brackets, skipping strings and comments, which may contain them.
+    const RawTextContext ctx = { *document._json };
+    auto& ranges = document._ranges;
+    std::vector<size_t> unclosed;
+    const char* pos = ctx.begin;
+    while ((pos = scanPlainChars(pos, ctx.end)) < ctx.end) {
+        switch (*pos) {
+            case '{':
+            case '[':
+                unclosed.push_back(ranges.size());
+                ranges.push_back({ uint32_t(pos - ctx.begin), 0 });
+                ++pos;
+                break;
+            case '}':
+            case ']': {
+                const char opening = *pos == '}' ? '{' : '[';
+                if (unclosed.empty()
+                    || ctx.begin[ranges[unclosed.back()].begin] != opening)
+                {
+                    _logErrorAtPos(
+                        logger,
+                        ctx,
+                        pos,
+                        std::string("Unbalanced '") + *pos + "'."
+                    );
+                    return std::nullopt;
+                }
+                ranges[unclosed.back()].end = uint32_t(pos - ctx.begin);
+                unclosed.pop_back();
+                ++pos;
+                break;
+            }
+            case '"': {
+                const auto leftQuotePos = pos;
+                ++pos;
+                while (true) {
+                    pos = scanStringChars(pos, ctx.end);
+                    if (pos < ctx.end && *pos == '"') break;
+                    if (pos == ctx.end || *pos != '\\' || ctx.atLineEnd(pos)) {
+                        _logErrorAtPos(
+                            logger,
+                            ctx,
+                            leftQuotePos,
+                            "Unterminated string. "
+                            "Expected closing quote '\"' in same line."
+                        );
+                        return std::nullopt;
+                    }
+                    pos += 2;  // Skip the escape, which may be '\\"'.
+                }
+                ++pos;
+                break;
+            }
+            default:
+                if (ctx.end - pos >= 2 && pos[1] == '/') {
+                    pos = scanLineChars(pos, ctx.end);
+                } else {
+                    ++pos;
+                }
+                break;
+        }
+    }
+    if (!unclosed.empty()) {
+        _logErrorAtPos(
+            logger,
+            ctx,
+            ctx.begin + ranges[unclosed.back()].begin,
+            ctx.begin[ranges[unclosed.back()].begin] == '{'
+                ? "Unterminated object."
+                : "Unterminated array."
+        );
+        return std::nullopt;
+    }
+
+    pos = ctx.begin;
+    _skipWhitespace(ctx, pos);
+    if (pos == ctx.end) {
+        logger.error("Empty JSON.");
+        return std::nullopt;
+    }
+    document._rootPos = uint32_t(pos - ctx.begin);
+    if (*pos == '{' || *pos == '[') {
+        pos = ctx.begin + ranges.front().end + 1;
+        _skipWhitespace(ctx, pos);
+        if (pos < ctx.end) {
+            _logErrorAtPos(logger, ctx, pos, "Extra characters after JSON.");
+        }
+    }
+    return document;
+}
+
+LazyDocument::_Cursor LazyDocument::_root() {
+    _Cursor cursor = { nullptr, _rootPos };
+    _reuse(cursor);
+    return cursor;
+}
+
+bool LazyDocument::_step(_Cursor& cursor, std::string_view key) {
+    if (cursor.tree) {
+        cursor.tree = cursor.tree->subTree(key);
+        return cursor.tree != nullptr;
+    }
+    const RawTextContext ctx = { *_json };
+    const char* pos = ctx.begin + cursor.pos;
+    if (*pos != '{') return false;
+    ++pos;  // Skip initial brace
+
+    const char* found = nullptr;
+    bool isRepeated = false;
+    std::string buffer;
+    while (true) {
+        _skipWhitespace(ctx, pos);
+        if (*pos == '}') break;
+        if (*pos != '"') {
+            _logErrorAtPos(
+                _logger,
+                ctx,
+                pos,
+                "Expected quoted string with '\"' as object key."
+            );
+            return false;
+        }
+        const auto member = _parseStringContent(buffer, ctx, pos, _logger);
+        if (!member) return false;
+        const bool matched = *member == key;
+        _skipWhitespace(ctx, pos);
+        if (pos == ctx.end || *pos != ':') {
+            _logErrorAtPos(_logger, ctx, pos, "Expected ':' in object.");
+            return false;
+        }
+        ++pos;
+        _skipWhitespace(ctx, pos);
+        if (matched) {
+            isRepeated = found != nullptr;
+            found = pos;
+        }
+        pos = _skip(pos);
+        if (!pos) return false;
+        _skipWhitespace(ctx, pos);
+        if (*pos == '}') break;
+        if (*pos != ',') {
+            _logErrorAtPos(
+                _logger, ctx, pos, "Expected ',' or '}' at the end of object."
+            );
+            return false;
+        }
+        ++pos;
+    }
+    if (!found) return false;
+    if (isRepeated) {
+        // Members of a repeated key are merged by `parse`, e.g. objects, so
+        // the whole object is parsed the same way.
+        const auto tree = _parse(cursor);
+        cursor.tree = tree ? tree->subTree(key) : nullptr;
+        return cursor.tree != nullptr;
+    }
+    cursor.pos = uint32_t(found - ctx.begin);
+    _reuse(cursor);
+    return true;
+}
+
+bool LazyDocument::_step(_Cursor& cursor, size_t index) {
+    if (cursor.tree) {
+        cursor.tree = cursor.tree->subTree(index);
+        return cursor.tree != nullptr;
+    }
+    const RawTextContext ctx = { *_json };
+    const char* pos = ctx.begin + cursor.pos;
+    if (*pos != '[') return false;
+    ++pos;  // Skip initial bracket
+    for (size_t idx = 0;; ++idx) {
+        _skipWhitespace(ctx, pos);
+        if (*pos == ']') return false;
+        if (idx == index) break;
+        pos = _skip(pos);
+        if (!pos) return false;
+        _skipWhitespace(ctx, pos);
+        if (*pos == ']') return false;
+        if (*pos != ',') {
+            _logErrorAtPos(_logger, ctx, pos, "Expected ',' or ']' in array.");
+            return false;
+        }
+        ++pos;
+    }
+    cursor.pos = uint32_t(pos - ctx.begin);
+    _reuse(cursor);
+    return true;
+}
+
+bool LazyDocument::_step(_Cursor& cursor, const Path& path) {
+    for (const auto& step: path.steps()) {
+        const bool found = std::visit(
+            [this, &cursor](const auto& key) { return _step(cursor, key); },
+            step
+        );
+        if (!found) return false;
+    }
+    return true;
+}
+
+void LazyDocument::_reuse(_Cursor& cursor) const {
+    if (_parsed.empty()) return;
+    const auto it = _parsed.find(cursor.pos);
+    if (it != _parsed.end()) cursor.tree = &it->second;
+}
+
+const char* LazyDocument::_skip(const char* pos) const {
+    const RawTextContext ctx = { *_json };
+    if (*pos == '{' || *pos == '[') {
+        const uint32_t begin = uint32_t(pos - ctx.begin);
+        const auto it = std::lower_bound(
+            _ranges.begin(),
+            _ranges.end(),
+            begin,
+            [](const _Range& range, uint32_t begin) {
+                return range.begin < begin;
+            }
+        );
+        assert(it != _ranges.end() && it->begin == begin);
+        return ctx.begin + it->end + 1;
+    }
+    if (*pos == '"') {
+        // Strings are known to be terminated by `index`.
+        ++pos;
+        while (*(pos = scanStringChars(pos, ctx.end)) != '"') pos += 2;
+        return pos + 1;
+    }
+    // Numbers and literals end at a delimiter.
+    const char* const startPos = pos;
+    while (pos < ctx.end && *pos != ',' && *pos != '}' && *pos != ']'
+           && *pos != '/' && !std::isspace(uint8_t(*pos)))
+    {
+        ++pos;
+    }
+    if (pos == startPos) {
+        _logErrorAtPos(
+            _logger,
+            ctx,
+            pos,
+            std::string("Invalid JSON value with head: '") + *pos + "'."
+        );
+        return nullptr;
+    }
+    return pos;
+}
+
+const ValueTree* LazyDocument::_parse(const _Cursor& cursor) {
+    if (cursor.tree) return cursor.tree;
+    const RawTextContext ctx = { *_json };
+    const char* pos = ctx.begin + cursor.pos;
+    ValueTree tree;
+    _TreeBuilder builder(tree, _options);
+    if (_parseValue(builder, ctx, pos, _options, _logger)
+        != _ParseStatus::MORE)
+    {
+        _logger.error("Failed to parse JSON.");
+        return nullptr;
+    }
+    _parsedBytes += size_t(pos - (ctx.begin + cursor.pos));
+    return &_parsed.emplace(cursor.pos, std::move(tree)).first->second;
+}
+
+/// Characters which must be escaped in JSON strings.
+static bool _needEscape(char c) {
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+static void _escapeString(std::string_view input, Sink& sink) {
+    const char* pos = input.data();
+    const char* const end = pos + input.size();
+    while (pos < end) {
+        // Write the run of characters without escapes at once.
+        const char* runEnd = pos;
+        while (runEnd < end && !_needEscape(*runEnd)) ++runEnd;
+        sink.write(pos, runEnd - pos);
+        if (runEnd == end) break;
+        pos = runEnd;
+        switch (*pos) {
+            case '"': sink.write("\\\"", 2); break;
+            case '\\': sink.write("\\\\", 2); break;
+            case '\b': sink.write("\\b", 2); break;
+            case '\f': sink.write("\\f", 2); break;
+            case '\n': sink.write("\\n", 2); break;
+            case '\r': sink.write("\\r", 2); break;
+            case '\t': sink.write("\\t", 2); break;
+            default: {
+                static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+                const char escaped[] = { '\\', 'u', '0', '0',
+                                         HEX_DIGITS[(*pos >> 4) & 0xF],
+                                         HEX_DIGITS[*pos & 0xF] };
+                sink.write(escaped, sizeof(escaped));
+            } break;
+        }
+        ++pos;
+    }
+}
+
+/// Write the shortest text which parses back to the same number, of the
+/// same type. Integral NUMBERs get a fraction, so that they do NOT parse back
+/// as INTEGER.
+template <typename T>
+static void _dumpNumber(T value, Sink& sink) {
+    char buffer[32];
+    const auto [end, ec] =
+        std::to_chars(buffer, buffer + sizeof(buffer), value);
+    assert(ec == std::errc());
+    sink.write(buffer, end - buffer);
+    if constexpr (std::is_floating_point_v<T>) {
+        if (std::find_if(buffer, end, [](char c) {
+                return !std::isdigit(uint8_t(c)) && c != '-';
+            }) == end)
+        {
+            sink.write(".0", 2);
+        }
+    }
+}
+
+static void _dumpValue(const ValueNode& node, Sink& sink) {
+    switch (node.typeTag()) {
+        case TypeTag::NONE: {
+            sink.write("null", 4);
+        } break;
+
+        case TypeTag::BOOL: {
+            if (*node.value<TypeTag::BOOL>()) sink.write("true", 4);
+            else sink.write("false", 5);
+        } break;
+
+        case TypeTag::NUMBER: {
+            _dumpNumber(*node.value<TypeTag::NUMBER>(), sink);
+        } break;
+
+        case TypeTag::INTEGER: {
+            _dumpNumber(*node.value<TypeTag::INTEGER>(), sink);
+        } break;
+
+        case TypeTag::STRING: {
+            sink.put('"');
+            _escapeString(*node.stringView(), sink);
+            sink.put('"');
+        } break;
+    }
+}
+
+/// An array or object being dumped by `_dump`.
+struct _DumpFrame {
+    /// Exactly one of `array` and `object` is set.
+    const ArrayNode* array = nullptr;
+    const ObjectNode* object = nullptr;
+
+    /// Next element of `array` or next member of `object`.
+    size_t index = 0;
+    ObjectNode::const_iterator it;
+
+    /// Indent of the brackets.
+    size_t indent = 0;
+
+    /// Whether no member is dumped yet.
+    bool isEmpty = true;
+};
+
+/// Dump with an explicit stack of the enclosing arrays and objects instead of
+/// recursion, so that trees of any depth can be dumped.
+static void _dump(
+    const ValueTree& tree,
+    Sink& sink,
+    bool pretty,
+    size_t indent,
+    size_t indentStep
+) {
+    std::vector<_DumpFrame> frames;
+    // Dump a value, or open an array or object to dump its members later.
+    const auto open = [&frames, &sink](const ValueTree& tree, size_t indent) {
+        switch (tree.state()) {
+            case ValueTree::State::EMPTY: break;
+
+            case ValueTree::State::VALUE: {
+                _dumpValue(*tree.getValue(), sink);
+            } break;
+
+            case ValueTree::State::ARRAY: {
+                sink.put('[');
+                _DumpFrame frame;
+                frame.array = tree.getArray();
+                frame.indent = indent;
+                frames.push_back(frame);
+            } break;
+
+            case ValueTree::State::OBJECT: {
+                sink.put('{');
+                _DumpFrame frame;
+                frame.object = tree.getObject();
+                frame.it = frame.object->begin();
+                frame.indent = indent;
+                frames.push_back(frame);
+            } break;
+        }
+    };
+
+    open(tree, indent);
+    while (!frames.empty()) {
+        // `open` may push a frame, so `frame` is NOT used after it.
+        auto& frame = frames.back();
+        const ValueTree* value = nullptr;
+        const ObjectKey* key = nullptr;
+        if (frame.array) {
+            const auto& array = *frame.array;
+            while (!value && frame.index < array.size()) {
+                value = &array[frame.index++];
+                if (value->isEmpty()) value = nullptr;
+            }
+        } else {
+            while (!value && frame.it != frame.object->end()) {
+                const auto& [memberKey, member] = *frame.it++;
+                if (member.isEmpty()) continue;
+                key = &memberKey;
+                value = &member;
+            }
+        }
+
+        if (!value) {
+            if (pretty && !frame.isEmpty) {
+                sink.put('\n');
+                sink.fill(' ', frame.indent);
+            }
+            sink.put(frame.array ? ']' : '}');
+            frames.pop_back();
+            continue;
+        }
+        if (!frame.isEmpty) sink.put(',');
+        frame.isEmpty = false;
+        const size_t newIndent = frame.indent + indentStep;
+        if (pretty) {
+            sink.put('\n');
+            sink.fill(' ', newIndent);
+        }
+        if (key) {
+            sink.put('"');
+            _escapeString(*key, sink);
+            sink.put('"');
+            if (pretty) sink.write(": ", 2);
+            else sink.put(':');
+        }
+        open(*value, newIndent);
+    }
+}
+
+static void _dumpCanonicalValue(const ValueNode& node, Sink& sink) {
+    if (node.typeTag() == TypeTag::NUMBER) {
+        // -0.0 equals 0.0.
+        _dumpNumber(*node.value<TypeTag::NUMBER>() + 0.0, sink);
+    } else {
+        _dumpValue(node, sink);
+    }
+}
+
+/// An array or object being dumped by `_dumpCanonical`.
+struct _CanonicalFrame {
+    /// Set for an array, otherwise `entries` are the members of an object.
+    const ArrayNode* array = nullptr;
+
+    /// Non-empty members, sorted by bytes of their keys.
+    std::vector<std::pair<std::string_view, const ValueTree*>> entries;
+
+    /// Next element of `array` or next member in `entries`.
+    size_t index = 0;
+
+    /// Whether no member is dumped yet.
+    bool isEmpty = true;
+};
+
+/// Dump with an explicit stack of the enclosing arrays and objects instead of
+/// recursion, the same as `_dump`.
+static void _dumpCanonical(const ValueTree& tree, Sink& sink) {
+    std::vector<_CanonicalFrame> frames;
+    // Dump a value, or open an array or object to dump its members later.
+    const auto open = [&frames, &sink](const ValueTree& tree) {
+        switch (tree.state()) {
+            case ValueTree::State::EMPTY: break;
+
+            case ValueTree::State::VALUE: {
+                _dumpCanonicalValue(*tree.getValue(), sink);
+            } break;
+
+            case ValueTree::State::ARRAY: {
+                sink.put('[');
+                _CanonicalFrame frame;
+                frame.array = tree.getArray();
+                frames.push_back(std::move(frame));
+            } break;
+
+            case ValueTree::State::OBJECT: {
+                sink.put('{');
+                // Sorted by bytes, whatever the order of the object is.
+                _CanonicalFrame frame;
+                auto& entries = frame.entries;
+                entries.reserve(tree.getObject()->size());
+                for (const auto& [key, value]: *tree.getObject()) {
+                    if (!value.isEmpty()) entries.emplace_back(key, &value);
+                }
+                const auto byKey = [](const auto& lhs, const auto& rhs) {
+                    return lhs.first < rhs.first;
+                };
+                if (!std::is_sorted(entries.begin(), entries.end(), byKey)) {
+                    std::sort(entries.begin(), entries.end(), byKey);
+                }
+                frames.push_back(std::move(frame));
+            } break;
+        }
+    };
+
+    open(tree);
+    while (!frames.empty()) {
+        // `open` may push a frame, so `frame` is NOT used after it.
+        auto& frame = frames.back();
+        const ValueTree* value = nullptr;
+        const std::string_view* key = nullptr;
+        if (frame.array) {
+            const auto& array = *frame.array;
+            while (!value && frame.index < array.size()) {
+                value = &array[frame.index++];
+                if (value->isEmpty()) value = nullptr;
+            }
+        } else if (frame.index < frame.entries.size()) {
+            const auto& entry = frame.entries[frame.index++];
+            key = &entry.first;
+            value = entry.second;
+        }
+
+        if (!value) {
+            sink.put(frame.array ? ']' : '}');
+            frames.pop_back();
+            continue;
+        }
+        if (!frame.isEmpty) sink.put(',');
+        frame.isEmpty = false;
+        if (key) {
+            sink.put('"');
+            _escapeString(*key, sink);
+            sink.write("\":", 2);
+        }
+        open(*value);
+    }
+}
+
+void dumpCanonical(const ValueTree& tree, Sink& sink) {
+    _dumpCanonical(tree, sink);
+}
+
+std::string dumpCanonical(const ValueTree& tree) {
+    std::string output;
+    {
+        Sink sink(output);
+        _dumpCanonical(tree, sink);
+    }
+    return output;
+}
+
+void dump(const ValueTree& tree, Sink& sink, bool pretty, size_t indentStep) {
+    _dump(tree, sink, pretty, 0, indentStep);
+}
+
+std::string dump(const ValueTree& tree, bool pretty, size_t indentStep) {
+    std::string output;
+    {
+        Sink sink(output);
+        _dump(tree, sink, pretty, 0, indentStep);
+    }
+    return output;
+}
+
+bool dumpFile(
+    const ValueTree& tree,
+    const std::string& path,
+    bool pretty,
+    size_t indentStep,
+    const Logger& logger
+) {
+    return writeFile(
+        path,
+        [&](std::FILE* file) {
+            Sink sink(file);
+            dump(tree, sink, pretty, indentStep);
+            sink.flush();
+            return !std::ferror(file);
+        },
+        logger
+    );
 }
 
 }  // namespace json
@@ -0,0 +1,213 @@
+#include "c2p/merge.hpp"
+
+#include <cassert>
+#include <utility>
+
+namespace c2p {
+
+/// A tree of one layer at the current path of merging.
+struct _Layer {
+    ValueTree* tree;
+    bool movable;
+};
+
+/// Non-const access to movable layers, so that shared trees are unshared
+/// before their subtrees are moved, see `ValueTree::share()`.
+static const ArrayNode* _getArray(const _Layer& layer) {
+    if (layer.movable) return layer.tree->getArray();
+    return std::as_const(*layer.tree).getArray();
+}
+
+static const ObjectNode* _getObject(const _Layer& layer) {
+    if (layer.movable) return layer.tree->getObject();
+    return std::as_const(*layer.tree).getObject();
+}
+
+/// Move or copy a tree of a layer into `dest`.
+static void _take(ValueTree& dest, const ValueTree& tree, bool movable) {
+    if (movable) dest = std::move(const_cast<ValueTree&>(tree));
+    else dest = tree;
+}
+
+/// Reserve capacity of objects which support it, see `FlatMap`.
+template <typename Object>
+static auto _reserve(Object& object, size_t size, int)
+    -> decltype(object.reserve(size), void()) {
+    object.reserve(size);
+}
+
+template <typename Object>
+static void _reserve(Object&, size_t, long) {}
+
+/// Get the first layer of the run of layers which are merged with the last
+/// one, the others are overridden. All layers are NOT empty.
+template <typename Layers, typename GetState>
+static size_t _runBegin(
+    const Layers& layers,
+    size_t size,
+    const MergeOptions& options,
+    GetState&& getState
+) {
+    assert(size > 0);
+    const auto state = getState(layers[size - 1]);
+    const bool mergeable =
+        (state == ValueTree::State::OBJECT
+         && options.objects == MergeOptions::Objects::DEEP)
+        || (state == ValueTree::State::ARRAY
+            && options.arrays == MergeOptions::Arrays::APPEND);
+    if (!mergeable) return size - 1;
+    size_t begin = size - 1;
+    while (begin > 0 && getState(layers[begin - 1]) == state) --begin;
+    return begin;
+}
+
+/// Merge `count` layers, all of them NOT empty, into `dest`.
+static void _merge(
+    ValueTree& dest,
+    const _Layer* layers,
+    size_t count,
+    const MergeOptions& options
+) {
+    const auto getState = [](const _Layer& layer) {
+        return layer.tree->state();
+    };
+    const size_t begin = _runBegin(layers, count, options, getState);
+    layers += begin;
+    count -= begin;
+    if (count == 1) {
+        _take(dest, *layers[0].tree, layers[0].movable);
+        return;
+    }
+
+    if (layers[0].tree->isArray()) {
+        size_t size = 0;
+        for (size_t idx = 0; idx < count; ++idx) {
+            size += _getArray(layers[idx])->size();
+        }
+        auto& array = dest.asArray();
+        array.reserve(array.size() + size);
+        for (size_t idx = 0; idx < count; ++idx) {
+            for (const auto& element: *_getArray(layers[idx])) {
+                _take(array.emplace_back(), element, layers[idx].movable);
+            }
+        }
+        return;
+    }
+
+    assert(layers[0].tree->isObject());
+    size_t size = 0;
+    for (size_t idx = 0; idx < count; ++idx) {
+        size += _getObject(layers[idx])->size();
+    }
+    auto& object = dest.asObject();
+    _reserve(object, size, 0);
+
+    // Merge the subtrees of each key once, at its first appearance.
+    std::vector<_Layer> subLayers;
+    subLayers.reserve(count);
+    for (size_t idx = 0; idx < count; ++idx) {
+        for (const auto& [key, subTree]: *_getObject(layers[idx])) {
+            if (subTree.isEmpty() || object.find(key) != object.end()) {
+                continue;
+            }
+            subLayers.clear();
+            subLayers.push_back(
+                { const_cast<ValueTree*>(&subTree), layers[idx].movable }
+            );
+            for (size_t upper = idx + 1; upper < count; ++upper) {
+                const auto& upperObject = *_getObject(layers[upper]);
+                const auto it = upperObject.find(key);
+                if (it == upperObject.end() || it->second.isEmpty()) continue;
+                subLayers.push_back({ const_cast<ValueTree*>(&it->second),
+                                      layers[upper].movable });
+            }
+            _merge(object[key], subLayers.data(), subLayers.size(), options);
+        }
+    }
+}
+
+ValueTree merge(
+    std::initializer_list<MergeLayer> layers,
+    const MergeOptions& options
+) {
+    return merge(std::vector<MergeLayer>(layers), options);
+}
+
+ValueTree merge(
+    const std::vector<MergeLayer>& layers,
+    const MergeOptions& options
+) {
+    std::vector<_Layer> nonEmptyLayers;
+    nonEmptyLayers.reserve(layers.size());
+    for (const auto& layer: layers) {
+        if (!layer.tree()->isEmpty()) {
+            nonEmptyLayers.push_back({ layer.tree(), layer.movable() });
+        }
+    }
+    ValueTree tree;
+    if (nonEmptyLayers.empty()) return tree;
+    _merge(tree, nonEmptyLayers.data(), nonEmptyLayers.size(), options);
+    return tree;
+}
+
+OverlayView::OverlayView(
+    std::vector<const ValueTree*> layers,
+    const MergeOptions& options
+)
+    : _layers(std::move(layers)), _options(options) {
+    _normalize();
+}
+
+void OverlayView::_normalize() {
+    size_t size = 0;
+    for (const auto layer: _layers) {
+        if (layer && !layer->isEmpty()) _layers[size++] = layer;
+    }
+    _layers.resize(size);
+    if (_layers.empty()) return;
+    const size_t begin = _runBegin(
+        _layers,
+        _layers.size(),
+        _options,
+        [](const ValueTree* layer) { return layer->state(); }
+    );
+    _layers.erase(_layers.begin(), _layers.begin() + begin);
+}
+
+OverlayView OverlayView::subView(std::string_view key) const {
+    std::vector<const ValueTree*> subLayers;
+    if (state() == ValueTree::State::OBJECT) {
+        subLayers.reserve(_layers.size());
+        for (const auto layer: _layers) {
+            subLayers.push_back(layer->subTree(key));
+        }
+    }
+    return OverlayView(std::move(subLayers), _options);
+}
+
+OverlayView OverlayView::subView(size_t index) const {
+    std::vector<const ValueTree*> subLayers;
+    if (state() == ValueTree::State::ARRAY) {
+        // Arrays of all layers are appended, see `_normalize()`.
+        for (const auto layer: _layers) {
+            const auto& array = *layer->getArray();
+            if (index < array.size()) {
+                subLayers.push_back(&array[index]);
+                break;
+            }
+            index -= array.size();
+        }
+    }
+    return OverlayView(std::move(subLayers), _options);
+}
+
+ValueTree OverlayView::merged() const {
+    std::vector<MergeLayer> layers;
+    layers.reserve(_layers.size());
+    for (const auto layer: _layers) {
+        layers.emplace_back(*layer);
+    }
+    return merge(layers, _options);
+}
+
+}  // namespace c2p
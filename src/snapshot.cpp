@@ -0,0 +1,166 @@
+#include "c2p/snapshot.hpp"
+
+#include "file_io.hpp"
+#include "xxh64.hpp"
+
+#include <c2p/json.hpp>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace c2p {
+namespace snapshot {
+
+/// Size and last write time of the source file.
+struct _SourceStamp {
+    uint64_t size = 0;
+    int64_t time = 0;
+};
+
+static std::optional<_SourceStamp>
+_stamp(const std::string& sourcePath, const Logger& logger) {
+    if (sourcePath.empty()) return _SourceStamp();
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(sourcePath, ec);
+    if (ec) {
+        logger.error(sourcePath + ": Cannot stat file: " + ec.message());
+        return std::nullopt;
+    }
+    const auto time = std::filesystem::last_write_time(sourcePath, ec);
+    if (ec) {
+        logger.error(sourcePath + ": Cannot stat file: " + ec.message());
+        return std::nullopt;
+    }
+    return _SourceStamp{ uint64_t(size),
+                         int64_t(time.time_since_epoch().count()) };
+}
+
+static bool _write(
+    const FrozenTree& tree,
+    const std::string& path,
+    const _SourceStamp& stamp,
+    const Logger& logger
+) {
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.sourceSize = stamp.size;
+    header.sourceTime = stamp.time;
+    header.checksum = xxh64(tree.data(), tree.size());
+    header.treeSize = tree.size();
+
+    // Concurrent loads see either the old or the new snapshot.
+    return writeFile(
+        path,
+        [&](std::FILE* file) {
+            return std::fwrite(&header, sizeof(header), 1, file) == 1
+                && std::fwrite(tree.data(), 1, tree.size(), file)
+                       == tree.size();
+        },
+        logger
+    );
+}
+
+static std::optional<FrozenTree> _load(
+    const std::string& path,
+    const _SourceStamp& stamp,
+    const Logger& logger
+) {
+    size_t size = 0;
+    const auto data = mapFile(path, size, logger);
+    if (!data) return std::nullopt;
+
+    Header header;
+    if (size < sizeof(header)) {
+        logger.error(path + ": Snapshot is truncated.");
+        return std::nullopt;
+    }
+    std::memcpy(&header, data.get(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        logger.error(path + ": NOT a snapshot file.");
+        return std::nullopt;
+    }
+    if (header.byteOrder != BYTE_ORDER_MARK) {
+        logger.error(path + ": Snapshot is of another byte order.");
+        return std::nullopt;
+    }
+    if (header.version != VERSION) {
+        logger.info(
+            path + ": Snapshot is of version " + std::to_string(header.version)
+            + ", expected " + std::to_string(VERSION) + "."
+        );
+        return std::nullopt;
+    }
+    if (header.sourceSize != stamp.size || header.sourceTime != stamp.time) {
+        logger.info(path + ": Snapshot is stale.");
+        return std::nullopt;
+    }
+    if (header.treeSize != size - sizeof(header)) {
+        logger.error(path + ": Snapshot is truncated.");
+        return std::nullopt;
+    }
+    const char* treeData = data.get() + sizeof(header);
+    if (xxh64(treeData, header.treeSize) != header.checksum) {
+        logger.error(path + ": Snapshot checksum mismatch.");
+        return std::nullopt;
+    }
+    // The tree keeps the whole mapping alive.
+    return FrozenTree::constructFrom(
+        std::shared_ptr<const char>(data, treeData), header.treeSize, logger
+    );
+}
+
+bool write(
+    const FrozenTree& tree,
+    const std::string& path,
+    const std::string& sourcePath,
+    const Logger& logger
+) {
+    const auto stamp = _stamp(sourcePath, logger);
+    if (!stamp) return false;
+    return _write(tree, path, *stamp, logger);
+}
+
+std::optional<FrozenTree> load(
+    const std::string& path,
+    const std::string& sourcePath,
+    const Logger& logger
+) {
+    const auto stamp = _stamp(sourcePath, logger);
+    if (!stamp) return std::nullopt;
+    return _load(path, *stamp, logger);
+}
+
+FrozenTree loadOrParse(
+    const std::string& path,
+    const std::string& jsonPath,
+    const Logger& logger
+) {
+    // The stamp is taken before reading, so that a modification during the
+    // read makes the new snapshot stale.
+    const auto stamp = _stamp(jsonPath, logger);
+    if (!stamp) return FrozenTree();
+
+    const Logger warnings(
+        logger.logWarningCallback,
+        logger.logWarningCallback,
+        logger.logInfoCallback
+    );
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) {
+        if (auto tree = _load(path, *stamp, warnings)) return std::move(*tree);
+    } else {
+        logger.info(path + ": Snapshot is missing.");
+    }
+
+    const ValueTree tree = json::parseFile(jsonPath, json::ParseOptions(), logger);
+    if (tree.isEmpty()) return FrozenTree();
+    FrozenTree frozen(tree);
+    _write(frozen, path, *stamp, warnings);
+    return frozen;
+}
+
+}  // namespace snapshot
+}  // namespace c2p
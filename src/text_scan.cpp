@@ -0,0 +1,408 @@
+#include "text_scan.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define C2P_SCAN_X86
+#include <immintrin.h>
+#endif
+
+#if defined(C2P_SCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define C2P_SCAN_AVX2
+#define C2P_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace c2p {
+
+// ============================================================
+// scalar:
+// ============================================================
+
+static bool _isWhitespace(char c) {
+    // Wraps around as a byte, so that bytes below '\t' do NOT match, the
+    // same as the SIMD masks.
+    return c == ' '
+        || uint8_t(uint8_t(c) - uint8_t('\t')) <= uint8_t('\r' - '\t');
+}
+
+static bool _isStringChar(char c) {
+    return c != '"' && c != '\\' && c != '\n' && c != '\r';
+}
+
+static bool _isLineChar(char c) { return c != '\n' && c != '\r'; }
+
+/// '{' and '[' differ only in bit 0x20, and so do '}' and ']'.
+static bool _isStructuralChar(char c) {
+    const char lower = char(c | 0x20);
+    return lower == '{' || lower == '}' || c == '"' || c == '/';
+}
+
+static const char* _scanWhitespaceScalar(const char* pos, const char* end) {
+    while (pos < end && _isWhitespace(*pos)) ++pos;
+    return pos;
+}
+
+static const char* _scanStringCharsScalar(const char* pos, const char* end) {
+    while (pos < end && _isStringChar(*pos)) ++pos;
+    return pos;
+}
+
+static const char* _scanLineCharsScalar(const char* pos, const char* end) {
+    while (pos < end && _isLineChar(*pos)) ++pos;
+    return pos;
+}
+
+static const char* _scanPlainCharsScalar(const char* pos, const char* end) {
+    while (pos < end && !_isStructuralChar(*pos)) ++pos;
+    return pos;
+}
+
+#ifdef C2P_SCAN_X86
+
+// ============================================================
+// SSE2 (16 bytes per step):
+// ============================================================
+
+static int _countTrailingZeros(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return int(idx);
+#endif
+}
+
+/// Mask of bytes which are whitespaces: ' ' or '\t' ~ '\r'.
+static __m128i _whitespaceMaskSse2(__m128i chunk) {
+    const __m128i offset = _mm_sub_epi8(chunk, _mm_set1_epi8('\t'));
+    const __m128i range = _mm_cmpeq_epi8(
+        _mm_min_epu8(offset, _mm_set1_epi8('\r' - '\t')), offset
+    );
+    return _mm_or_si128(range, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+}
+
+/// Mask of bytes which are line breaks: '\n' or '\r'.
+static __m128i _lineBreakMaskSse2(__m128i chunk) {
+    return _mm_or_si128(
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')),
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))
+    );
+}
+
+/// Mask of bytes which stop a plain string: '"', '\\', '\n' or '\r'.
+static __m128i _stringStopMaskSse2(__m128i chunk) {
+    return _mm_or_si128(
+        _lineBreakMaskSse2(chunk),
+        _mm_or_si128(
+            _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+            _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'))
+        )
+    );
+}
+
+/// Mask of bytes which are '{', '}', '[', ']', '"' or '/'.
+static __m128i _structuralMaskSse2(__m128i chunk) {
+    const __m128i lower = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+    return _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(lower, _mm_set1_epi8('{')),
+            _mm_cmpeq_epi8(lower, _mm_set1_epi8('}'))
+        ),
+        _mm_or_si128(
+            _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+            _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/'))
+        )
+    );
+}
+
+static const char* _scanWhitespaceSse2(const char* pos, const char* end) {
+    for (; end - pos >= 16; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)pos);
+        const int mask = _mm_movemask_epi8(_whitespaceMaskSse2(chunk));
+        if (mask != 0xFFFF) return pos + _countTrailingZeros(~uint32_t(mask));
+    }
+    return _scanWhitespaceScalar(pos, end);
+}
+
+static const char* _scanStringCharsSse2(const char* pos, const char* end) {
+    for (; end - pos >= 16; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)pos);
+        const uint32_t stop =
+            uint32_t(_mm_movemask_epi8(_stringStopMaskSse2(chunk)));
+        if (stop) return pos + _countTrailingZeros(stop);
+    }
+    return _scanStringCharsScalar(pos, end);
+}
+
+static const char* _scanLineCharsSse2(const char* pos, const char* end) {
+    for (; end - pos >= 16; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)pos);
+        const uint32_t stop =
+            uint32_t(_mm_movemask_epi8(_lineBreakMaskSse2(chunk)));
+        if (stop) return pos + _countTrailingZeros(stop);
+    }
+    return _scanLineCharsScalar(pos, end);
+}
+
+static const char* _scanPlainCharsSse2(const char* pos, const char* end) {
+    for (; end - pos >= 16; pos += 16) {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)pos);
+        const uint32_t stop =
+            uint32_t(_mm_movemask_epi8(_structuralMaskSse2(chunk)));
+        if (stop) return pos + _countTrailingZeros(stop);
+    }
+    return _scanPlainCharsScalar(pos, end);
+}
+
+#endif  // C2P_SCAN_X86
+
+#ifdef C2P_SCAN_AVX2
+
+// ============================================================
+// AVX2 (32 bytes per step):
+// ============================================================
+
+C2P_TARGET_AVX2 static __m256i _whitespaceMaskAvx2(__m256i chunk) {
+    const __m256i offset = _mm256_sub_epi8(chunk, _mm256_set1_epi8('\t'));
+    const __m256i range = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(offset, _mm256_set1_epi8('\r' - '\t')), offset
+    );
+    return _mm256_or_si256(
+        range, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '))
+    );
+}
+
+C2P_TARGET_AVX2 static __m256i _lineBreakMaskAvx2(__m256i chunk) {
+    return _mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')),
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))
+    );
+}
+
+C2P_TARGET_AVX2 static __m256i _stringStopMaskAvx2(__m256i chunk) {
+    return _mm256_or_si256(
+        _lineBreakMaskAvx2(chunk),
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))
+        )
+    );
+}
+
+C2P_TARGET_AVX2 static __m256i _structuralMaskAvx2(__m256i chunk) {
+    const __m256i lower = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))
+        ),
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('/'))
+        )
+    );
+}
+
+C2P_TARGET_AVX2 static const char*
+_scanWhitespaceAvx2(const char* pos, const char* end) {
+    for (; end - pos >= 32; pos += 32) {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i*)pos);
+        const int mask = _mm256_movemask_epi8(_whitespaceMaskAvx2(chunk));
+        if (mask != -1) return pos + _countTrailingZeros(~uint32_t(mask));
+    }
+    return _scanWhitespaceSse2(pos, end);
+}
+
+C2P_TARGET_AVX2 static const char*
+_scanStringCharsAvx2(const char* pos, const char* end) {
+    for (; end - pos >= 32; pos += 32) {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i*)pos);
+        const uint32_t stop =
+            uint32_t(_mm256_movemask_epi8(_stringStopMaskAvx2(chunk)));
+        if (stop) return pos + _countTrailingZeros(stop);
+    }
+    return _scanStringCharsSse2(pos, end);
+}
+
+C2P_TARGET_AVX2 static const char*
+_scanLineCharsAvx2(const char* pos, const char* end) {
+    for (; end - pos >= 32; pos += 32) {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i*)pos);
+        const uint32_t stop =
+            uint32_t(_mm256_movemask_epi8(_lineBreakMaskAvx2(chunk)));
+        if (stop) return pos + _countTrailingZeros(stop);
+    }
+    return _scanLineCharsSse2(pos, end);
+}
+
+C2P_TARGET_AVX2 static const char*
+_scanPlainCharsAvx2(const char* pos, const char* end) {
+    for (; end - pos >= 32; pos += 32) {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i*)pos);
+        const uint32_t stop =
+            uint32_t(_mm256_movemask_epi8(_structuralMaskAvx2(chunk)));
+        if (stop) return pos + _countTrailingZeros(stop);
+    }
+    return _scanPlainCharsSse2(pos, end);
+}
+
+#endif  // C2P_SCAN_AVX2
+
+// ============================================================
+// runtime dispatch:
+// ============================================================
+
+using ScanFunc = const char* (*)(const char* pos, const char* end);
+
+struct Scanner {
+    const char* name;
+    ScanFunc scanWhitespace;
+    ScanFunc scanStringChars;
+    ScanFunc scanLineChars;
+    ScanFunc scanPlainChars;
+};
+
+static constexpr Scanner _SCALAR_SCANNER = {
+    "scalar",
+    _scanWhitespaceScalar,
+    _scanStringCharsScalar,
+    _scanLineCharsScalar,
+    _scanPlainCharsScalar,
+};
+
+static Scanner _selectScanner() {
+    const char* const forced = std::getenv("C2P_SCAN");
+    const auto allowed = [forced](const char* name) {
+        return !forced || std::strcmp(forced, name) == 0;
+    };
+    (void)allowed;
+
+#ifdef C2P_SCAN_AVX2
+    if (allowed("avx2") && __builtin_cpu_supports("avx2")) {
+        return {
+            "avx2",
+            _scanWhitespaceAvx2,
+            _scanStringCharsAvx2,
+            _scanLineCharsAvx2,
+            _scanPlainCharsAvx2,
+        };
+    }
+#endif
+
+#ifdef C2P_SCAN_X86
+    if (allowed("sse2")) {
+        return {
+            "sse2",
+            _scanWhitespaceSse2,
+            _scanStringCharsSse2,
+            _scanLineCharsSse2,
+            _scanPlainCharsSse2,
+        };
+    }
+#endif
+
+    return _SCALAR_SCANNER;
+}
+
+#ifndef NDEBUG
+/// Check that `scanner` stops at the same positions as the scalar one for
+/// every byte, in runs ending inside and after full SIMD chunks.
+static bool _agreesWithScalar(const Scanner& scanner) {
+    const ScanFunc funcs[][2] = {
+        { scanner.scanWhitespace, _SCALAR_SCANNER.scanWhitespace },
+        { scanner.scanStringChars, _SCALAR_SCANNER.scanStringChars },
+        { scanner.scanLineChars, _SCALAR_SCANNER.scanLineChars },
+        { scanner.scanPlainChars, _SCALAR_SCANNER.scanPlainChars },
+    };
+    // A byte skipped by each function, to make runs of.
+    const char runChars[] = { ' ', 'a', 'a', 'a' };
+    const size_t runSizes[] = { 0, 1, 15, 16, 17, 31, 32, 33, 40, 64, 65 };
+    char text[80];
+    for (size_t func = 0; func < 4; ++func) {
+        const auto [scan, scanScalar] = funcs[func];
+        for (int byte = 0; byte < 256; ++byte) {
+            for (const size_t runSize: runSizes) {
+                // A run ended by `byte`, and a run of `byte` itself.
+                std::memset(text, runChars[func], sizeof(text));
+                text[runSize] = char(byte);
+                const size_t sizes[] = { runSize + 1, sizeof(text) };
+                for (const size_t size: sizes) {
+                    if (scan(text, text + size)
+                        != scanScalar(text, text + size)) {
+                        return false;
+                    }
+                }
+                std::memset(text, byte, sizeof(text));
+                if (scan(text, text + runSize)
+                    != scanScalar(text, text + runSize)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/// Check all implementations which the CPU supports, whichever is chosen.
+static bool _checkScanners() {
+#ifdef C2P_SCAN_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        const Scanner avx2 = {
+            "avx2",
+            _scanWhitespaceAvx2,
+            _scanStringCharsAvx2,
+            _scanLineCharsAvx2,
+            _scanPlainCharsAvx2,
+        };
+        if (!_agreesWithScalar(avx2)) return false;
+    }
+#endif
+#ifdef C2P_SCAN_X86
+    const Scanner sse2 = {
+        "sse2",
+        _scanWhitespaceSse2,
+        _scanStringCharsSse2,
+        _scanLineCharsSse2,
+        _scanPlainCharsSse2,
+    };
+    if (!_agreesWithScalar(sse2)) return false;
+#endif
+    return true;
+}
+#endif  // NDEBUG
+
+static const Scanner& _scanner() {
+    static const Scanner scanner = _selectScanner();
+#ifndef NDEBUG
+    // Checked once in debug builds.
+    static const bool isChecked = _checkScanners();
+    assert(isChecked);
+#endif
+    return scanner;
+}
+
+const char* scanWhitespace(const char* pos, const char* end) {
+    // Most whitespace runs between tokens are short.
+    if (pos < end && !_isWhitespace(*pos)) return pos;
+    return _scanner().scanWhitespace(pos, end);
+}
+
+const char* scanStringChars(const char* pos, const char* end) {
+    return _scanner().scanStringChars(pos, end);
+}
+
+const char* scanLineChars(const char* pos, const char* end) {
+    return _scanner().scanLineChars(pos, end);
+}
+
+const char* scanPlainChars(const char* pos, const char* end) {
+    return _scanner().scanPlainChars(pos, end);
+}
+
+const char* scanImplementation() { return _scanner().name; }
+
+}  // namespace c2p
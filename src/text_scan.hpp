@@ -0,0 +1,38 @@
+/**
+ * @file text_scan.hpp
+ * @brief Vectorized scanning of character classes in a text.
+ *
+ * Each function returns the first position in [pos, end) which does NOT
+ * belong to the scanned run, or `end` if the whole range belongs to it.
+ *
+ * The implementation (AVX2, SSE2 or scalar) is chosen once at runtime by the
+ * CPU features. Set the environment variable `C2P_SCAN` to "sse2" or "scalar"
+ * to force a slower implementation, e.g. for benchmarking.
+ */
+
+#ifndef __C2P_TEXT_SCAN_HPP__
+#define __C2P_TEXT_SCAN_HPP__
+
+namespace c2p {
+
+/// Skip a run of whitespaces, same as `std::isspace`.
+const char* scanWhitespace(const char* pos, const char* end);
+
+/// Skip a run of plain string characters.
+/// Stops at '"', '\\', '\n' or '\r'.
+const char* scanStringChars(const char* pos, const char* end);
+
+/// Skip a run of characters in the same line.
+/// Stops at '\n' or '\r'.
+const char* scanLineChars(const char* pos, const char* end);
+
+/// Skip a run of characters without JSON structure.
+/// Stops at '{', '}', '[', ']', '"' or '/'.
+const char* scanPlainChars(const char* pos, const char* end);
+
+/// Name of the implementation chosen at runtime: "avx2", "sse2" or "scalar".
+const char* scanImplementation();
+
+}  // namespace c2p
+
+#endif  // __C2P_TEXT_SCAN_HPP__
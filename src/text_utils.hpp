@@ -6,8 +6,13 @@
 #ifndef __C2P_TEXT_UTILS_HPP__
 #define __C2P_TEXT_UTILS_HPP__
 
+#include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace c2p {
@@ -36,8 +41,13 @@ struct LineInText {
 
 /// Split text into lines.
 /// Allowing for '\n', '\r', and '\r\n' as line breaks.
-inline std::vector<LineInText> splitLines(const std::string& text) {
+inline std::vector<LineInText> splitLines(std::string_view text) {
     std::vector<LineInText> lines;
+    // Allocate once. "\r\n" is counted twice, which is fine.
+    lines.reserve(
+        std::count(text.begin(), text.end(), '\n')
+        + std::count(text.begin(), text.end(), '\r') + 1
+    );
     uint32_t pos = 0;
     uint32_t len = 0;
     uint32_t lenExcludingBreaks = 0;
@@ -71,10 +81,10 @@ inline std::vector<LineInText> splitLines(const std::string& text) {
 /// Describes a text context.
 /// Provides access to the original text and its lines table.
 struct TextContext {
-    const std::string& text;
+    const std::string_view text;
     const std::vector<LineInText> lines;
 
-    TextContext(const std::string& text): text(text), lines(splitLines(text)) {}
+    TextContext(std::string_view text): text(text), lines(splitLines(text)) {}
 
     /// Move the position forward by one character.
     /// If the new position is out of the text:
@@ -215,14 +225,99 @@ struct TextContext {
     std::string_view
     slice(const PositionInText& start, const PositionInText& end) const {
         if (!start.valid) return std::string_view("");
-        if (!end.valid) return std::string_view(text.data() + start.pos);
+        if (!end.valid) return text.substr(start.pos);
         return std::string_view(text.data() + start.pos, end.pos - start.pos);
     }
 };
 
-/// Get a message marked with '^' at the position in the text.
+/// Describes a text context without a lines table.
+///
+/// The text is scanned forward through raw pointers in a single pass. Line
+/// information of a position is computed only on demand by `locate()`, e.g.
+/// when an error message is reported.
+struct RawTextContext {
+    const char* const begin;
+    const char* const end;
+
+    RawTextContext(const std::string& text)
+        : begin(text.data()), end(text.data() + text.size()) {}
+
+    RawTextContext(const char* begin, const char* end)
+        : begin(begin), end(end) {}
+
+    /// Position of `begin` in the whole text, if the text is one chunk of it.
+    PositionInText origin = {
+        .valid = true, .pos = 0, .lineIdx = 0, .linePos = 0
+    };
+
+    /// Check if the position is a line break character.
+    static bool isLineBreak(char c) { return c == '\n' || c == '\r'; }
+
+    /// Check if the position is the last character of its line, which is the
+    /// last line break character of the line or the last character of the
+    /// text. Same as `TextContext::atLineEnd`.
+    bool atLineEnd(const char* pos) const {
+        if (pos + 1 >= end) return pos + 1 == end;
+        if (*pos == '\n') return true;
+        return *pos == '\r' && pos[1] != '\n';
+    }
+
+    /// Get the start of the next line.
+    /// If there is no next line, returns `end`.
+    const char* nextLine(const char* pos) const {
+        while (pos < end && !atLineEnd(pos)) ++pos;
+        return pos < end ? pos + 1 : end;
+    }
+
+    /// Compute the line information of a position by scanning the text from
+    /// the beginning. A position at the end of the text is clamped to the
+    /// last character, same as an invalid `PositionInText`.
+    PositionInText locate(const char* pos) const {
+        assert(begin < end);
+        if (pos >= end) pos = end - 1;
+        PositionInText result = {
+            .valid = true, .pos = 0, .lineIdx = 0, .linePos = 0
+        };
+        const char* lineStart = begin;
+        for (const char* cur = begin; cur < pos; ++cur) {
+            if (atLineEnd(cur)) {
+                ++result.lineIdx;
+                lineStart = cur + 1;
+            }
+        }
+        result.pos = uint32_t(pos - begin);
+        result.linePos = uint32_t(pos - lineStart);
+        return result;
+    }
+
+    /// Convert a position returned by `locate()` into the whole text, see
+    /// `origin`.
+    PositionInText inWholeText(const PositionInText& pos) const {
+        PositionInText result = pos;
+        result.pos += origin.pos;
+        result.lineIdx += origin.lineIdx;
+        if (pos.lineIdx == 0) result.linePos += origin.linePos;
+        return result;
+    }
+
+    /// Get the line of a position returned by `locate()`.
+    LineInText lineAt(const PositionInText& pos) const {
+        const char* const lineStart = begin + pos.pos - pos.linePos;
+        const char* lineEnd = lineStart;
+        while (lineEnd < end && !isLineBreak(*lineEnd)) ++lineEnd;
+        const uint32_t lenExcludingBreaks = uint32_t(lineEnd - lineStart);
+        return {
+            .pos = uint32_t(lineStart - begin),
+            .len = uint32_t(nextLine(lineStart) - lineStart),
+            .lenExcludingBreaks = lenExcludingBreaks,
+        };
+    }
+};
+
+/// Get a message marked with '^' at the position in the line of the text.
 inline std::vector<std::string> getPositionMessage(
-    const TextContext& ctx,
+    const char* text,
+    const LineInText& line,
     const PositionInText& pos,
     uint32_t maxPrefixLen = 80,
     uint32_t maxSuffixLen = 80
@@ -231,8 +326,6 @@ inline std::vector<std::string> getPositionMessage(
 
     std::vector<std::string> msg;
 
-    const auto& line = ctx.lines[pos.lineIdx];
-
     const uint32_t prefixLen =
         pos.linePos > maxPrefixLen ? maxPrefixLen : pos.linePos;
 
@@ -244,7 +337,8 @@ inline std::vector<std::string> getPositionMessage(
     );
 
     std::string textLine =
-        " | " + ctx.text.substr(pos.pos - prefixLen, suffixLen + prefixLen + 1);
+        " | "
+        + std::string(text + pos.pos - prefixLen, suffixLen + prefixLen + 1);
     std::replace(textLine.begin(), textLine.end(), '\n', ' ');
     std::replace(textLine.begin(), textLine.end(), '\r', ' ');
 
@@ -256,6 +350,62 @@ inline std::vector<std::string> getPositionMessage(
     return msg;
 }
 
+/// Get a message marked with '^' at the position in the text.
+inline std::vector<std::string> getPositionMessage(
+    const TextContext& ctx,
+    const PositionInText& pos,
+    uint32_t maxPrefixLen = 80,
+    uint32_t maxSuffixLen = 80
+) {
+    return getPositionMessage(
+        ctx.text.data(),
+        ctx.lines[pos.lineIdx],
+        pos,
+        maxPrefixLen,
+        maxSuffixLen
+    );
+}
+
+/// Get a message marked with '^' at the position in the text.
+inline std::vector<std::string> getPositionMessage(
+    const RawTextContext& ctx,
+    const PositionInText& pos,
+    uint32_t maxPrefixLen = 80,
+    uint32_t maxSuffixLen = 80
+) {
+    return getPositionMessage(
+        ctx.begin, ctx.lineAt(pos), pos, maxPrefixLen, maxSuffixLen
+    );
+}
+
+/// Convert a decimal number text to double.
+/// Allowing for a leading '+'. Without allocation and independent of locale.
+/// Returns std::nullopt if the text is invalid or out of range.
+inline std::optional<double> toDouble(std::string_view text) {
+    if (!text.empty() && text[0] == '+') text.remove_prefix(1);
+    double value = 0;
+    const auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/// Convert a decimal integer text to int64_t.
+/// Allowing for a leading '+'. Without allocation and independent of locale.
+/// Returns std::nullopt if the text is invalid or out of range.
+inline std::optional<int64_t> toInteger(std::string_view text) {
+    if (!text.empty() && text[0] == '+') text.remove_prefix(1);
+    int64_t value = 0;
+    const auto [end, ec] =
+        std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
 /// Trans Unicode code point to UTF-8 bytes.
 inline std::string unicodeToUtf8(uint32_t codePoint) {
     std::string utf8;
@@ -0,0 +1,56 @@
+/**
+ * @file tree_reuse.hpp
+ * @brief Reusing the storage of a ValueTree which is parsed into again.
+ */
+
+#ifndef __C2P_TREE_REUSE_HPP__
+#define __C2P_TREE_REUSE_HPP__
+
+#include <c2p/value_tree.hpp>
+
+#include <string_view>
+#include <utility>
+
+namespace c2p {
+
+/// Whether the storage of the top level of `tree` can be reused for a tree
+/// allocating from `resource`: it is NOT shared, and an array or object
+/// allocates from `resource`.
+inline bool isReusable(const ValueTree& tree, MemoryResource* resource) {
+    if (tree.isShared()) return false;
+    if (const auto array = tree.getArray()) {
+        return array->get_allocator().resource() == resource;
+    }
+    if (const auto object = tree.getObject()) {
+        return object->get_allocator().resource() == resource;
+    }
+    return true;
+}
+
+/// Move all members of `object` into `spare`, which is empty and allocates
+/// from the same resource. They are moved back one by one by `takeMember`.
+inline void detachMembers(ObjectNode& object, ObjectNode& spare) {
+    std::swap(object, spare);
+#ifdef C2P_FLAT_OBJECT_NODE
+    // Members are moved back in input order, into one allocation.
+    object.reserve(spare.size());
+#endif
+}
+
+/// Move the member at `key` of `spare` into `object`, keeping the storage of
+/// its subtree, and the node of the map where possible.
+/// Return nullptr if `spare` has no member at `key`.
+inline ValueTree*
+takeMember(ObjectNode& spare, std::string_view key, ObjectNode& object) {
+    const auto it = spare.find(key);
+    if (it == spare.end()) return nullptr;
+#ifdef C2P_FLAT_OBJECT_NODE
+    return &object.emplace(ObjectKey(key), std::move(it->second)).first->second;
+#else
+    return &object.insert(spare.extract(it)).position->second;
+#endif
+}
+
+}  // namespace c2p
+
+#endif  // __C2P_TREE_REUSE_HPP__